@@ -0,0 +1,330 @@
+/* Hash table benchmarks. These aren't unit tests, they just time some common
+operations so that we can compare storage engines and growth policies.
+
+Build with optimizations, e.g.
+    g++ -std=c++11 -O2 -pthread Benchmark.cxx -o Benchmark
+Building with -std=c++20 adds the interleaved (coroutine) lookup benchmarks. */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include "HashTable.cxx"
+
+
+// Nanoseconds per operation since Start
+static double ns_per_op(std::chrono::steady_clock::time_point Start, unsigned N_Ops) {
+  std::chrono::duration<double, std::nano> Elapsed = std::chrono::steady_clock::now() - Start;
+  return Elapsed.count()/N_Ops;
+} // static double ns_per_op(std::chrono::steady_clock::time_point Start, unsigned N_Ops) {
+
+
+
+/* Insert Keys into an empty table, then look every key up (hits, first one at
+a time and then in batches), then look up keys that aren't in the table
+(misses), first with find and then with search. Misses in search throw, so
+we do fewer of them. Prints the time per operation of each phase. */
+template<typename Table>
+void Benchmark(const char* Name, const std::vector<unsigned>& Keys) {
+  const unsigned N_Keys = (unsigned)Keys.size();
+  Table H{};
+
+  std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+  for(unsigned i = 0; i < N_Keys; i++) { H.insert(Keys[i], i); }
+  double Insert_Time = ns_per_op(Start, N_Keys);
+
+  // Sum the values so that the compiler can't skip the lookups.
+  double Sum = 0;
+  Start = std::chrono::steady_clock::now();
+  for(unsigned i = 0; i < N_Keys; i++) { Sum += H.search(Keys[i]); }
+  double Hit_Time = ns_per_op(Start, N_Keys);
+
+  // The same lookups, in batches.
+  const unsigned Batch_Size = 256;
+  std::vector<double> Out(Batch_Size);
+  std::vector<uint64_t> Found_Mask(Batch_Size/64);
+  Start = std::chrono::steady_clock::now();
+  for(unsigned i = 0; i < N_Keys; i += Batch_Size) {
+    unsigned N = (N_Keys - i < Batch_Size) ? N_Keys - i : Batch_Size;
+    Sum += H.search_batch(&Keys[i], N, Out.data(), Found_Mask.data()) + Out[0];
+  } // for(unsigned i = 0; i < N_Keys; i += Batch_Size) {
+  double Batch_Hit_Time = ns_per_op(Start, N_Keys);
+
+  Start = std::chrono::steady_clock::now();
+  for(unsigned i = 0; i < N_Keys; i++) {
+    const double* Value = H.find(Keys[i] + 1);
+    Sum += (Value == NULL) ? 1 : *Value;
+  } // for(unsigned i = 0; i < N_Keys; i++) {
+  double Find_Miss_Time = ns_per_op(Start, N_Keys);
+
+  const unsigned N_Misses = N_Keys/100;
+  Start = std::chrono::steady_clock::now();
+  for(unsigned i = 0; i < N_Misses; i++) {
+    try { Sum += H.search(Keys[i] + 1); }
+    catch(const Invalid_Key& Er) { Sum += 1; }
+  } // for(unsigned i = 0; i < N_Misses; i++) {
+  double Miss_Time = ns_per_op(Start, N_Misses);
+
+  std::cout << std::left << std::setw(40) << Name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << Insert_Time
+            << std::setw(12) << Hit_Time
+            << std::setw(12) << Batch_Hit_Time
+            << std::setw(12) << Find_Miss_Time
+            << std::setw(12) << Miss_Time
+            << "    (" << Sum << ")" << std::endl;
+} // void Benchmark(const char* Name, const std::vector<unsigned>& Keys) {
+
+
+
+/* Load Keys into an empty table three ways: one insert at a time, one insert
+at a time after reserving room for every key, and with one range insert.
+Prints the time per key of each. */
+template<typename Table>
+void Benchmark_Bulk_Load(const char* Name, const std::vector<unsigned>& Keys) {
+  const unsigned N_Keys = (unsigned)Keys.size();
+  std::vector< std::pair<unsigned, double> > Items(N_Keys);
+  for(unsigned i = 0; i < N_Keys; i++) { Items[i] = std::make_pair(Keys[i], (double)i); }
+
+  Table H1{};
+  std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+  for(unsigned i = 0; i < N_Keys; i++) { H1.insert(Keys[i], i); }
+  double Insert_Time = ns_per_op(Start, N_Keys);
+
+  Table H2{};
+  Start = std::chrono::steady_clock::now();
+  H2.reserve(N_Keys);
+  for(unsigned i = 0; i < N_Keys; i++) { H2.insert(Keys[i], i); }
+  double Reserve_Time = ns_per_op(Start, N_Keys);
+
+  Table H3{};
+  Start = std::chrono::steady_clock::now();
+  H3.insert(Items.begin(), Items.end());
+  double Range_Time = ns_per_op(Start, N_Keys);
+
+  std::cout << std::left << std::setw(40) << Name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << Insert_Time
+            << std::setw(12) << Reserve_Time
+            << std::setw(12) << Range_Time
+            << "    (" << H1.size() + H2.size() + H3.size() << ")" << std::endl;
+} // void Benchmark_Bulk_Load(const char* Name, const std::vector<unsigned>& Keys) {
+
+
+
+// A Hash_Table behind one global mutex, to compare the concurrent tables with.
+struct Global_Lock_Table {
+  std::mutex Lock;
+  Hash_Table<unsigned, double> Items;
+
+  void insert(unsigned key, double value) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Items.insert(key, value);
+  } // void insert(unsigned key, double value) {
+
+  double get_or(unsigned key, double Default) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    return Items.get_or(key, Default);
+  } // double get_or(unsigned key, double Default) {
+}; // struct Global_Lock_Table {
+
+
+
+/* Load Keys into a table, then have 1, 2, 4, and 8 threads use it at once.
+Each thread does a mix of lookups and updates (one update per Read_Ratio
+lookups) of random keys. Prints the wall clock time per operation (over all
+threads) for each thread count. */
+template<typename Table>
+void Benchmark_Concurrent(const char* Name, const std::vector<unsigned>& Keys, unsigned Read_Ratio) {
+  const unsigned N_Keys = (unsigned)Keys.size();
+  const unsigned N_Ops = 1000000;
+  Table H{};
+  for(unsigned i = 0; i < N_Keys; i++) { H.insert(Keys[i], i); }
+
+  std::cout << std::left << std::setw(40) << Name << std::right << std::fixed << std::setprecision(1);
+  for(unsigned N_Threads = 1; N_Threads <= 8; N_Threads *= 2) {
+    std::vector<double> Sums(N_Threads, 0);
+    std::vector<std::thread> Threads;
+
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    for(unsigned t = 0; t < N_Threads; t++) {
+      Threads.push_back(std::thread([&H, &Keys, &Sums, N_Keys, N_Ops, Read_Ratio, t]() {
+        unsigned Random = 12345 + t;
+        for(unsigned i = 0; i < N_Ops; i++) {
+          Random = Random*1103515245u + 12345u;
+          unsigned key = Keys[(Random >> 8) % N_Keys];
+          if(i % (Read_Ratio + 1) == 0) { H.insert(key, i); }
+          else { Sums[t] += H.get_or(key, 0); }
+        } // for(unsigned i = 0; i < N_Ops; i++) {
+      })); // Threads.push_back(std::thread([...]() {
+    } // for(unsigned t = 0; t < N_Threads; t++) {
+    for(unsigned t = 0; t < N_Threads; t++) { Threads[t].join(); }
+
+    std::cout << std::setw(12) << ns_per_op(Start, N_Threads*N_Ops);
+  } // for(unsigned N_Threads = 1; N_Threads <= 8; N_Threads *= 2) {
+  std::cout << std::endl;
+} // void Benchmark_Concurrent(const char* Name, const std::vector<unsigned>& Keys, unsigned Read_Ratio) {
+
+
+
+/* Load Keys into an empty table from 4 threads at once (each inserting a
+quarter of them), so the table grows many times. Prints the time per insert
+(over all threads) and the longest any one insert took, which is where a
+table that grows all at once pays for it. */
+template<typename Table>
+void Benchmark_Concurrent_Load(const char* Name, const std::vector<unsigned>& Keys) {
+  const unsigned N_Keys = (unsigned)Keys.size();
+  const unsigned N_Threads = 4;
+  Table H{};
+  std::vector<double> Worst(N_Threads, 0);
+  std::vector<std::thread> Threads;
+
+  std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+  for(unsigned t = 0; t < N_Threads; t++) {
+    Threads.push_back(std::thread([&H, &Keys, &Worst, N_Keys, t]() {
+      for(unsigned i = t; i < N_Keys; i += N_Threads) {
+        std::chrono::steady_clock::time_point Insert_Start = std::chrono::steady_clock::now();
+        H.insert(Keys[i], i);
+        std::chrono::duration<double, std::micro> Elapsed = std::chrono::steady_clock::now() - Insert_Start;
+        if(Elapsed.count() > Worst[t]) { Worst[t] = Elapsed.count(); }
+      } // for(unsigned i = t; i < N_Keys; i += N_Threads) {
+    })); // Threads.push_back(std::thread([...]() {
+  } // for(unsigned t = 0; t < N_Threads; t++) {
+  for(unsigned t = 0; t < N_Threads; t++) { Threads[t].join(); }
+  double Insert_Time = ns_per_op(Start, N_Keys);
+
+  double Worst_Time = 0;
+  for(unsigned t = 0; t < N_Threads; t++) { Worst_Time = (Worst[t] > Worst_Time) ? Worst[t] : Worst_Time; }
+  std::cout << std::left << std::setw(40) << Name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << Insert_Time << std::setw(12) << Worst_Time << std::endl;
+} // void Benchmark_Concurrent_Load(const char* Name, const std::vector<unsigned>& Keys) {
+
+
+
+#if defined(HASH_TABLE_COROUTINES)
+/* Look up every key in a chained table of N_Keys keys one at a time (with
+search), in batches (with search_batch), and interleaved (with
+search_interleaved). Tables this big don't fit in the last level cache, so
+most lookups miss. Prints the time per lookup of each. */
+void Benchmark_Interleaved(unsigned N_Keys) {
+  std::vector<unsigned> Keys(N_Keys);
+  for(unsigned i = 0; i < N_Keys; i++) { Keys[i] = i*16; }
+  for(unsigned i = N_Keys - 1; i > 0; i--) { std::swap(Keys[i], Keys[rand() % (i + 1)]); }
+
+  Hash_Table<unsigned, double> H{};
+  H.reserve(N_Keys);
+  for(unsigned i = 0; i < N_Keys; i++) { H.insert(Keys[i], i); }
+
+  // Look the keys up in a different order than we inserted them.
+  for(unsigned i = N_Keys - 1; i > 0; i--) { std::swap(Keys[i], Keys[rand() % (i + 1)]); }
+
+  double Sum = 0;
+  std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+  for(unsigned i = 0; i < N_Keys; i++) { Sum += H.search(Keys[i]); }
+  double Serial_Time = ns_per_op(Start, N_Keys);
+
+  const unsigned Batch_Size = 1024;
+  std::vector<double> Out(Batch_Size);
+  std::vector<uint64_t> Found_Mask(Batch_Size/64);
+  Start = std::chrono::steady_clock::now();
+  for(unsigned i = 0; i < N_Keys; i += Batch_Size) {
+    unsigned N = (N_Keys - i < Batch_Size) ? N_Keys - i : Batch_Size;
+    Sum += H.search_batch(&Keys[i], N, Out.data(), Found_Mask.data()) + Out[0];
+  } // for(unsigned i = 0; i < N_Keys; i += Batch_Size) {
+  double Batch_Time = ns_per_op(Start, N_Keys);
+
+  std::cout << std::setw(12) << N_Keys << std::fixed << std::setprecision(1)
+            << std::setw(12) << Serial_Time << std::setw(12) << Batch_Time;
+
+  const unsigned In_Flight[] = {4, 8, 16, 32};
+  for(unsigned j = 0; j < 4; j++) {
+    Start = std::chrono::steady_clock::now();
+    for(unsigned i = 0; i < N_Keys; i += Batch_Size) {
+      unsigned N = (N_Keys - i < Batch_Size) ? N_Keys - i : Batch_Size;
+      Sum += H.search_interleaved(&Keys[i], N, Out.data(), Found_Mask.data(), In_Flight[j]) + Out[0];
+    } // for(unsigned i = 0; i < N_Keys; i += Batch_Size) {
+    std::cout << std::setw(12) << ns_per_op(Start, N_Keys);
+  } // for(unsigned j = 0; j < 4; j++) {
+
+  std::cout << "    (" << Sum << ")" << std::endl;
+} // void Benchmark_Interleaved(unsigned N_Keys) {
+#endif
+
+
+
+int main() {
+  typedef std::hash<unsigned> H;
+  typedef std::equal_to<unsigned> E;
+
+  /* Every key is a multiple of 16 (so they all have an odd key + 1, which we
+  use for misses). Shuffle them so that the lookups are in random order. */
+  const unsigned N_Keys = 1000000;
+  std::vector<unsigned> Keys(N_Keys);
+  for(unsigned i = 0; i < N_Keys; i++) { Keys[i] = i*16; }
+  srand(1);
+  for(unsigned i = N_Keys - 1; i > 0; i--) { std::swap(Keys[i], Keys[rand() % (i + 1)]); }
+
+  std::cout << N_Keys << " keys, ns per operation" << std::endl;
+  std::cout << std::left << std::setw(40) << "Table" << std::right
+            << std::setw(12) << "insert" << std::setw(12) << "hit" << std::setw(12) << "batch hit"
+            << std::setw(12) << "find miss" << std::setw(12) << "search miss" << std::endl;
+
+  // Growth policies
+  Benchmark< Hash_Table<unsigned, double, H, E, Chained_Storage, Modulo_Growth> >("Chained, modulo", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Chained_Storage, Power_Of_Two_Growth> >("Chained, power of two", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Chained_Storage, Prime_Growth> >("Chained, prime (fastmod)", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Unrolled_Storage, Modulo_Growth> >("Unrolled chains, modulo", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Unrolled_Storage, Prime_Growth> >("Unrolled chains, prime (fastmod)", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Inline_Chained_Storage, Modulo_Growth> >("Inline chains, modulo", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Inline_Chained_Storage, Prime_Growth> >("Inline chains, prime (fastmod)", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Linear_Probe_Storage, Modulo_Growth> >("Linear probing, modulo", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Linear_Probe_Storage, Power_Of_Two_Growth> >("Linear probing, power of two", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Linear_Probe_Storage, Prime_Growth> >("Linear probing, prime (fastmod)", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Robin_Hood_Storage, Modulo_Growth> >("Robin Hood, modulo", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Robin_Hood_Storage, Power_Of_Two_Growth> >("Robin Hood, power of two", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Robin_Hood_Storage, Prime_Growth> >("Robin Hood, prime (fastmod)", Keys);
+  Benchmark< Hash_Table<unsigned, double, H, E, Swiss_Storage> >("Swiss", Keys);
+
+  // Bulk loads
+  std::cout << std::endl << std::left << std::setw(40) << "Bulk load" << std::right
+            << std::setw(12) << "insert" << std::setw(12) << "reserve" << std::setw(12) << "range" << std::endl;
+  Benchmark_Bulk_Load< Hash_Table<unsigned, double> >("Chained, modulo", Keys);
+  Benchmark_Bulk_Load< Hash_Table<unsigned, double, H, E, Unrolled_Storage> >("Unrolled chains, modulo", Keys);
+  Benchmark_Bulk_Load< Hash_Table<unsigned, double, H, E, Inline_Chained_Storage> >("Inline chains, modulo", Keys);
+  Benchmark_Bulk_Load< Hash_Table<unsigned, double, H, E, Linear_Probe_Storage> >("Linear probing, modulo", Keys);
+  Benchmark_Bulk_Load< Hash_Table<unsigned, double, H, E, Robin_Hood_Storage> >("Robin Hood, modulo", Keys);
+  Benchmark_Bulk_Load< Hash_Table<unsigned, double, H, E, Swiss_Storage> >("Swiss", Keys);
+
+  // Concurrent tables (10 lookups per update)
+  std::cout << std::endl << std::left << std::setw(40) << "Concurrent, ns per operation" << std::right
+            << std::setw(12) << "1 thread" << std::setw(12) << "2 threads"
+            << std::setw(12) << "4 threads" << std::setw(12) << "8 threads" << std::endl;
+  Benchmark_Concurrent<Global_Lock_Table>("Global mutex", Keys, 10);
+  Benchmark_Concurrent< Striped_Hash_Table<unsigned, double> >("Striped, 64 stripes", Keys, 10);
+  Benchmark_Concurrent< Lock_Free_Read_Hash_Table<unsigned, double> >("Lock-free reads, 64 stripes", Keys, 10);
+  Benchmark_Concurrent< Split_Ordered_Hash_Table<unsigned, double> >("Split-ordered list", Keys, 10);
+  Benchmark_Concurrent< Seqlock_Hash_Table<unsigned, double> >("Seqlock buckets", Keys, 10);
+
+  // Concurrent loads (growing from empty)
+  std::cout << std::endl << std::left << std::setw(40) << "Concurrent load, 4 threads" << std::right
+            << std::setw(12) << "ns/insert" << std::setw(12) << "worst (us)" << std::endl;
+  Benchmark_Concurrent_Load<Global_Lock_Table>("Global mutex", Keys);
+  Benchmark_Concurrent_Load< Striped_Hash_Table<unsigned, double> >("Striped, 64 stripes", Keys);
+  Benchmark_Concurrent_Load< Lock_Free_Read_Hash_Table<unsigned, double> >("Lock-free reads, 64 stripes", Keys);
+  Benchmark_Concurrent_Load< Split_Ordered_Hash_Table<unsigned, double> >("Split-ordered list", Keys);
+  Benchmark_Concurrent_Load< Seqlock_Hash_Table<unsigned, double> >("Seqlock buckets", Keys);
+
+  #if defined(HASH_TABLE_COROUTINES)
+    // Interleaved lookups
+    std::cout << std::endl << "Chained lookups, ns per lookup" << std::endl
+              << std::setw(12) << "keys" << std::setw(12) << "serial" << std::setw(12) << "batch"
+              << std::setw(12) << "4 tasks" << std::setw(12) << "8 tasks"
+              << std::setw(12) << "16 tasks" << std::setw(12) << "32 tasks" << std::endl;
+    Benchmark_Interleaved(1000000);
+    Benchmark_Interleaved(4000000);
+    Benchmark_Interleaved(16000000);
+  #endif
+
+  return 0;
+} // int main() {
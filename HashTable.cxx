@@ -1,15 +1,84 @@
 #include <string>
 #include <iostream>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <type_traits>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <thread>
+
+/* The Swiss storage engine uses SSE2 to check 16 control bytes at once. Define
+HASH_TABLE_NO_SIMD to use the (portable) scalar version instead. */
+#if defined(__SSE2__) && !defined(HASH_TABLE_NO_SIMD)
+  #define HASH_TABLE_SSE2
+  #include <emmintrin.h>
+#endif
+
+/* Batched lookups prefetch the memory that each lookup is about to read. This
+is just a hint, so on compilers that don't have __builtin_prefetch it does
+nothing. */
+#if defined(__GNUC__) || defined(__clang__)
+  #define HASH_TABLE_PREFETCH(Address) __builtin_prefetch(Address)
+#else
+  #define HASH_TABLE_PREFETCH(Address) ((void)(Address))
+#endif
+
+/* Interleaved lookups (see Lookup_Task) need C++20 coroutines. Without them,
+the rest of the table still works; there's just no search_interleaved. */
+#if defined(__has_include)
+  #if __has_include(<coroutine>) && __cplusplus >= 202002L
+    #include <coroutine>
+    #include <exception>
+    #if defined(__cpp_impl_coroutine) && defined(__cpp_lib_coroutine)
+      #define HASH_TABLE_COROUTINES
+    #endif
+  #endif
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Key descriptions
+
+/* Describe a key for an error message. Numeric keys and strings are printed;
+other key types (which may not have an operator<<) just get a placeholder. */
+template<typename K>
+typename std::enable_if<std::is_arithmetic<K>::value, std::string>::type
+Describe_Key(const K& key) { return std::to_string(key); }
+
+template<typename K>
+typename std::enable_if<!std::is_arithmetic<K>::value, std::string>::type
+Describe_Key(const K&) { return "(unprintable key)"; }
+
+inline std::string Describe_Key(const std::string& key) { return "\"" + key + "\""; }
+
+
+
 
 
 ////////////////////////////////////////////////////////////////////////////////
 // Item, Item Node, Item List
 
+/* An item. The value is constructed straight from whatever arguments follow
+the key (so V doesn't need a default constructor, and a value can be built in
+place rather than copied in). */
 template<typename K, typename V>
 struct Item {
   K key;
   V value;
+
+  template<typename Key_Arg, typename... Args, typename =
+           typename std::enable_if<!std::is_same<typename std::decay<Key_Arg>::type, Item>::value>::type>
+  Item(Key_Arg&& key, Args&&... args) : key(std::forward<Key_Arg>(key)), value(std::forward<Args>(args)...) {}
 }; // struct Item {
 
 
@@ -17,27 +86,41 @@ struct Item {
 template<typename K, typename V>
 class Item_Node {
   private:
-    Item<K, V> Item;
+    ::Item<K, V> Item;
     Item_Node<K,V>* Next;
+    size_t Hash;                           // The key's hash (0 unless set with setHash)
 
   public:
-    // Constructor, destructor
-    Item_Node(const K& key, const V& value): Next(NULL) {
-      Item.key = key;
-      Item.value = value;
-    } // Item_Node(const K& key, const V& value): Next(NULL) {
-    ~Item_Node() {}
+    // Constructor, destructor. The value is constructed from args (see Item).
+    template<typename Key_Arg, typename... Args>
+    Item_Node(Key_Arg&& key, Args&&... args) : Item(std::forward<Key_Arg>(key), std::forward<Args>(args)...), Next(NULL), Hash(0) {}
+
+    // Defaulted so that nodes of trivial K and V are trivially destructible.
+    ~Item_Node() = default;
 
     ////////////////////////////////////////////////////////////////////////////
     // Key, value methods
 
-    // determine key and value of this node
-    V getValue() const { return Item.value; }
-    K getKey() const { return Item.key; }
+    /* determine key and value of this node. These return references so that
+    looking at a node never copies its key or value. */
+    const V& getValue() const { return Item.value; }
+    const K& getKey() const { return Item.key; }
 
     // We need to be able to update the item's value (though not the each node's
-    // key should be constant)
-    void setValue(V New_Value) { Item.value = New_Value; }
+    // key should be constant). This can also be done in place with getValue.
+    V& getValue() { return Item.value; }
+    void setValue(const V& New_Value) { Item.value = New_Value; }
+
+    // The node's item itself (so that tables can hand out pointers into it)
+    ::Item<K, V>& getItem() { return Item; }
+    const ::Item<K, V>& getItem() const { return Item; }
+
+
+    /* The key's hash. Lists that are given hashes (see Item_List) store them
+    here, so that they can skip nodes whose hash doesn't match without
+    comparing keys, and so a hash table can rehash without rehashing keys. */
+    size_t getHash() const { return Hash; }
+    void setHash(size_t Hash) { Item_Node::Hash = Hash; }
 
 
     ////////////////////////////////////////////////////////////////////////////
@@ -48,6 +131,167 @@ class Item_Node {
 
 
 
+/* Node allocators. Item lists get their nodes from (and give them back to) a
+node allocator, which provides
+    allocate(key, args...): Returns a new node holding key and a value
+        constructed from args.
+    deallocate(Node): Destroys and frees a node from allocate.
+Heap_Node_Allocator just uses new and delete. */
+template<typename K, typename V>
+struct Heap_Node_Allocator {
+  template<typename Key_Arg, typename... Args>
+  Item_Node<K, V>* allocate(Key_Arg&& key, Args&&... args) {
+    return new Item_Node<K, V>(std::forward<Key_Arg>(key), std::forward<Args>(args)...);
+  } // Item_Node<K, V>* allocate(Key_Arg&& key, Args&&... args) {
+
+  void deallocate(Item_Node<K, V>* Node) { delete Node; }
+}; // struct Heap_Node_Allocator {
+
+
+
+/* A pool of storage for objects of type T. Rather than allocating each object
+on its own, the pool carves them out of large slabs (so objects allocated
+together are next to each other in memory, and allocating one is usually just
+a pointer bump). Deallocated storage goes onto a free list (which is threaded
+through the freed storage itself) and is handed out again by later
+allocations. The pool only hands out raw (suitably aligned) storage; it's up
+to the user to construct and destroy objects in it.
+
+Memory is only returned when the pool is destroyed, at which point every slab
+is freed at once. */
+template<typename T>
+class Slab_Pool {
+  private:
+    // Storage for one object. While it's free, it holds the next free storage.
+    union Storage {
+      Storage* Next_Free;
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type Object;
+    }; // union Storage {
+
+    // Each slab starts with a header that links it to the previous slab.
+    struct Slab_Header {
+      Slab_Header* Next;
+    }; // struct Slab_Header {
+
+    Slab_Header* Slabs;                    // Most recently allocated slab
+    Storage* Free;                         // Free list
+    Storage* Bump;                         // Next never-used storage in the newest slab
+    Storage* Bump_End;                     // End of the newest slab
+    unsigned N_Free;                       // Number of storages on the free list
+    unsigned Next_Slab_Size;               // Number of objects in the next slab
+
+    // Slabs start small (so small tables stay small) and double up to this.
+    static const unsigned Max_Slab_Size = 4096;
+
+    Slab_Pool(const Slab_Pool &) = delete;
+    Slab_Pool& operator=(const Slab_Pool &) = delete;
+
+  public:
+    Slab_Pool() : Slabs(NULL), Free(NULL), Bump(NULL), Bump_End(NULL), N_Free(0), Next_Slab_Size(32) {}
+    ~Slab_Pool() {
+      while(Slabs != NULL) {
+        Slab_Header* Next = Slabs->Next;
+        ::operator delete(Slabs);
+        Slabs = Next;
+      } // while(Slabs != NULL) {
+    } // ~Slab_Pool() {
+
+
+    /* Allocate a new slab with room for (at least) N objects. Any unused
+    storage in the previous slab is moved onto the free list first.
+
+    operator new only promises the alignment of the fundamental types, so for
+    over-aligned types (e.g. cache line aligned ones) we allocate a little
+    extra and round the start of the objects up. */
+    void add_slab(unsigned N) {
+      for(; Bump != Bump_End; Bump++) {
+        Bump->Next_Free = Free;
+        Free = Bump;
+        N_Free++;
+      } // for(; Bump != Bump_End; Bump++) {
+
+      const size_t Alignment = alignof(Storage);
+      Slab_Header* Slab = static_cast<Slab_Header*>(::operator new(sizeof(Slab_Header) + Alignment - 1 + N*sizeof(Storage)));
+      Slab->Next = Slabs;
+      Slabs = Slab;
+
+      uintptr_t First = reinterpret_cast<uintptr_t>(Slab + 1);
+      First = (First + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+      Bump = reinterpret_cast<Storage*>(First);
+      Bump_End = Bump + N;
+    } // void add_slab(unsigned N) {
+
+
+    /* Make sure that the next N allocations can be served without allocating
+    another slab. */
+    void reserve(unsigned N) {
+      unsigned Available = N_Free + (unsigned)(Bump_End - Bump);
+      if(Available < N) { add_slab(N - Available); }
+    } // void reserve(unsigned N) {
+
+
+    // Storage for one T (reusing freed storage if there is any).
+    void* allocate() {
+      if(Free != NULL) {
+        Storage* Next = Free;
+        Free = Free->Next_Free;
+        N_Free--;
+        return Next;
+      } // if(Free != NULL) {
+
+      if(Bump == Bump_End) {
+        add_slab(Next_Slab_Size);
+        if(Next_Slab_Size < Max_Slab_Size) { Next_Slab_Size *= 2; }
+      } // if(Bump == Bump_End) {
+      return Bump++;
+    } // void* allocate() {
+
+
+    // Give back storage from allocate (whatever was in it must be destroyed).
+    void deallocate(void* Object) {
+      Storage* Freed = static_cast<Storage*>(Object);
+      Freed->Next_Free = Free;
+      Free = Freed;
+      N_Free++;
+    } // void deallocate(void* Object) {
+}; // class Slab_Pool {
+
+
+
+/* A pool of nodes (see Slab_Pool). Item lists can use a node pool as their
+node allocator. The pool doesn't destroy nodes that are still allocated when
+it is destroyed; that's up to whoever owns them. */
+template<typename K, typename V>
+class Node_Pool {
+  private:
+    Slab_Pool< Item_Node<K, V> > Pool;
+
+  public:
+    void add_slab(unsigned N_Nodes) { Pool.add_slab(N_Nodes); }
+    void reserve(unsigned N_Nodes) { Pool.reserve(N_Nodes); }
+
+
+    template<typename Key_Arg, typename... Args>
+    Item_Node<K, V>* allocate(Key_Arg&& key, Args&&... args) {
+      void* Storage = Pool.allocate();
+
+      // If constructing the node throws, give its storage back.
+      try { return new (Storage) Item_Node<K, V>(std::forward<Key_Arg>(key), std::forward<Args>(args)...); }
+      catch(...) {
+        Pool.deallocate(Storage);
+        throw;
+      } // catch(...) {
+    } // Item_Node<K, V>* allocate(Key_Arg&& key, Args&&... args) {
+
+
+    void deallocate(Item_Node<K, V>* Node) {
+      Node->~Item_Node<K, V>();
+      Pool.deallocate(Node);
+    } // void deallocate(Item_Node<K, V>* Node) {
+}; // class Node_Pool {
+
+
+
 // Item List exception classes.
 class List_Exception {
   private:
@@ -64,17 +308,42 @@ class Item_Not_In_List: public List_Exception {
 
 
 
-// Item list
-template<typename K, typename V>
+/* Item list. Keys are compared with KeyEqual. The list doesn't store a
+KeyEqual object; methods that compare keys take one as an (optional) argument
+so that a hash table can pass in its own.
+
+Likewise, methods that create or destroy nodes can be given a node allocator
+(see Node_Pool). If they aren't, nodes are allocated with new and deleted with
+delete. The destructor always uses delete, so a list whose nodes came from
+some other allocator needs to be emptied (with clear or release) before it is
+destroyed.
+
+find, remove and try_emplace can also be given the key's hash. New nodes then
+store it (see Item_Node::getHash), and the list only compares keys of nodes
+whose stored hash matches. This is much cheaper than comparing long keys (like
+strings) at every node. A list should either always or never be given hashes. */
+template<typename K, typename V, typename KeyEqual = std::equal_to<K> >
 class Item_List {
   private:
+    /* An empty list is just these two pointers set to NULL (Chained_Storage
+    relies on this to get arrays of empty lists from calloc). */
     Item_Node<K,V>* Start;                  // First node in the list
     Item_Node<K,V>* End;                    // Last node in the list
 
     /* Since lists deal with dynamic memory, we need to eliminate the default
     copy constructor and = operator */
-    Item_List(const Item_List<K, V> & ) = delete;
-    Item_List<K, V>& operator=(const Item_List &) = delete;
+    Item_List(const Item_List & ) = delete;
+    Item_List& operator=(const Item_List &) = delete;
+
+    /* If we get here then none of the items in the list had a key that
+    matched the specified key. As such, throw an exception! */
+    static void Throw_Not_In_List(const K& key) {
+      char Error_Message_Buffer[500];
+      snprintf(Error_Message_Buffer, sizeof(Error_Message_Buffer),
+               "Item Not In List Error: There are no items in this list with key %s\n",
+               Describe_Key(key).c_str());
+      throw Item_Not_In_List(Error_Message_Buffer);
+    } // static void Throw_Not_In_List(const K& key) {
 
   public:
     // Constructors, destructor
@@ -89,46 +358,188 @@ class Item_List {
     } // ~Item_List() {
 
 
-    /* Put a new value in the list. If the new value's key matches an existing
-    item's key then we update that item's value. Otherwise, add a new item
-    to the end of the list. */
-    void put(const K key, const V value) {
-      /* Check if any of the nodes in the list have a key that matches the new
-      key. If so, update that node's value. Otherwise, append a new node to the
-      end of the list */
-      Item_Node<K, V>* entry = Start;
-      while(entry != NULL) {
-        /* Check if the key of the current entry matches the key. If so, update
-        that node's value and return. Otherwise, move onto the next node */
-        if(entry->getKey() == key) {
-          entry->setValue(value);
-          return;
-        } // if(entry->getKey() == key) {
-        else { entry = entry->getNext(); }
-      } // while(entry != Null) {
+    /* Find the item with a particular key, adding one (whose value is
+    constructed from args) to the end of the list if there isn't one. Returns
+    the item's node and true if it's new. If the key was already in the list,
+    args are left alone. */
+    template<typename Allocator, typename Key_Arg, typename... Args>
+    std::pair<Item_Node<K, V>*, bool> try_emplace(const KeyEqual& Equal, Allocator& Nodes, Key_Arg&& key, Args&&... args) {
+      Item_Node<K, V>* entry = find(key, Equal);
+      if(entry != NULL) { return std::make_pair(entry, false); }
 
       /* If we are here then that means that new key did not match the key of
       any of the existing nodes in this list. That could mean the list is empty,
-      a case that we need to handle. */
+      a case that link handles. */
+      link(Nodes.allocate(std::forward<Key_Arg>(key), std::forward<Args>(args)...));
+      return std::make_pair(End, true);
+    } // std::pair<Item_Node<K, V>*, bool> try_emplace(const KeyEqual& Equal, Allocator& Nodes, Key_Arg&& key, Args&&... args) {
+
+    // The same, but Hash is the key's hash (which a new node stores).
+    template<typename Allocator, typename Key_Arg, typename... Args>
+    std::pair<Item_Node<K, V>*, bool> try_emplace(size_t Hash, const KeyEqual& Equal, Allocator& Nodes, Key_Arg&& key, Args&&... args) {
+      Item_Node<K, V>* entry = find(key, Hash, Equal);
+      if(entry != NULL) { return std::make_pair(entry, false); }
+
+      entry = Nodes.allocate(std::forward<Key_Arg>(key), std::forward<Args>(args)...);
+      entry->setHash(Hash);
+      link(entry);
+      return std::make_pair(End, true);
+    } // std::pair<Item_Node<K, V>*, bool> try_emplace(size_t Hash, const KeyEqual& Equal, Allocator& Nodes, Key_Arg&& key, Args&&... args) {
+
+
+    /* Put a new value in the list. If the new value's key matches an existing
+    item's key then we update that item's value. Otherwise, add a new item
+    to the end of the list. Returns true if a new item was added and false if
+    an existing item was updated. */
+    template<typename Allocator>
+    bool put(const K& key, const V& value, const KeyEqual& Equal, Allocator& Nodes) {
+      std::pair<Item_Node<K, V>*, bool> Result = try_emplace(Equal, Nodes, key, value);
+      if(Result.second == false) { Result.first->setValue(value); }
+      return Result.second;
+    } // bool put(const K& key, const V& value, const KeyEqual& Equal, Allocator& Nodes) {
+
+    bool put(const K& key, const V& value, const KeyEqual& Equal = KeyEqual()) {
+      Heap_Node_Allocator<K, V> Heap;
+      return put(key, value, Equal, Heap);
+    } // bool put(const K& key, const V& value, const KeyEqual& Equal = KeyEqual()) {
+
+
+    /* Merge a value into the list. If no item has the specified key, a new
+    item is added with value init. Otherwise, Merge(Value, init) is called,
+    where Value is a reference to the existing item's value (so Merge should
+    update it in place). Either way the list is only walked once. Returns true
+    if a new item was added. */
+    template<typename Function, typename Allocator>
+    bool upsert(const K& key, const V& init, Function Merge, const KeyEqual& Equal, Allocator& Nodes) {
+      std::pair<Item_Node<K, V>*, bool> Result = try_emplace(Equal, Nodes, key, init);
+      if(Result.second == false) { Merge(Result.first->getValue(), init); }
+      return Result.second;
+    } // bool upsert(const K& key, const V& init, Function Merge, const KeyEqual& Equal, Allocator& Nodes) {
+
+    template<typename Function>
+    bool upsert(const K& key, const V& init, Function Merge, const KeyEqual& Equal = KeyEqual()) {
+      Heap_Node_Allocator<K, V> Heap;
+      return upsert(key, init, Merge, Equal, Heap);
+    } // bool upsert(const K& key, const V& init, Function Merge, const KeyEqual& Equal = KeyEqual()) {
+
 
-      /* If Start == NULL then this is the first node in the list. */
-      if(Start == NULL) {
-        Start = new Item_Node<K, V>{key, value};
-        End = Start;
-      } // if(Start == NULL) {
+    /* Call Fn(Value), where Value is a reference to the value of the item
+    with the specified key. If there is no such item, one is added first with
+    a value-initialized value (e.g. 0 for numbers). Returns true if a new item
+    was added. */
+    template<typename Function, typename Allocator>
+    bool compute(const K& key, Function Fn, const KeyEqual& Equal, Allocator& Nodes) {
+      std::pair<Item_Node<K, V>*, bool> Result = try_emplace(Equal, Nodes, key);
+      Fn(Result.first->getValue());
+      return Result.second;
+    } // bool compute(const K& key, Function Fn, const KeyEqual& Equal, Allocator& Nodes) {
 
-      /* Otherwise, we need to append a new node onto the end of the existing
-      list */
+    template<typename Function>
+    bool compute(const K& key, Function Fn, const KeyEqual& Equal = KeyEqual()) {
+      Heap_Node_Allocator<K, V> Heap;
+      return compute(key, Fn, Equal, Heap);
+    } // bool compute(const K& key, Function Fn, const KeyEqual& Equal = KeyEqual()) {
+
+
+    /* Append an existing node onto the end of the list. The list takes
+    ownership of the node. This is used to move nodes between lists (when the
+    hash table is resized) without reallocating them. */
+    void link(Item_Node<K, V>* Node) {
+      Node->setNext(NULL);
+
+      /* If Start == NULL then this is the first node in the list. Otherwise,
+      we need to append the node onto the end of the existing list */
+      if(Start == NULL) { Start = End = Node; }
       else {
-        Item_Node<K, V>* New_End = new Item_Node<K, V>{key, value};
-        End->setNext(New_End);
-        End = New_End;
+        End->setNext(Node);
+        End = Node;
       } // else
-    } // void put(const K key, const V value) {
+    } // void link(Item_Node<K, V>* Node) {
+
+
+    // First node in the list (NULL if the list is empty)
+    Item_Node<K, V>* first() const { return Start; }
+
+
+    // Number of items in the list
+    unsigned size() const {
+      unsigned N = 0;
+      for(Item_Node<K, V>* entry = Start; entry != NULL; entry = entry->getNext()) { N++; }
+      return N;
+    } // unsigned size() const {
+
+
+    /* Detach every node from the list and return the first one. The list is
+    left empty and the caller becomes responsible for the returned nodes (which
+    are still linked together through their Next pointers). */
+    Item_Node<K, V>* release() {
+      Item_Node<K, V>* First = Start;
+      Start = End = NULL;
+      return First;
+    } // Item_Node<K, V>* release() {
+
+
+    // Remove every item from the list, giving the nodes back to Nodes.
+    template<typename Allocator>
+    void clear(Allocator& Nodes) {
+      Item_Node<K, V>* entry = release();
+      while(entry != NULL) {
+        Item_Node<K, V>* Next = entry->getNext();
+        Nodes.deallocate(entry);
+        entry = Next;
+      } // while(entry != NULL) {
+    } // void clear(Allocator& Nodes) {
+
+
+    /* Remove an item with a particular key from the list. Returns true if an
+    item was removed. */
+    template<typename Allocator>
+    bool remove(const K& key, const KeyEqual& Equal, Allocator& Nodes) { return Remove(key, false, 0, Equal, Nodes); }
+
+    // The same, but Hash is the key's hash (see find).
+    template<typename Allocator>
+    bool remove(const K& key, size_t Hash, const KeyEqual& Equal, Allocator& Nodes) { return Remove(key, true, Hash, Equal, Nodes); }
 
+    bool remove(const K& key, const KeyEqual& Equal = KeyEqual()) {
+      Heap_Node_Allocator<K, V> Heap;
+      return remove(key, Equal, Heap);
+    } // bool remove(const K& key, const KeyEqual& Equal = KeyEqual()) {
 
-    // Remove an item with a particular key from the list
-    void remove(const K key) {
+
+    /* Find the node with a particular key. Returns NULL if there is no such
+    node. This never throws (unless Equal does). */
+    Item_Node<K, V>* find(const K& key, const KeyEqual& Equal = KeyEqual()) const {
+      /* Search through the items in the list until we find one whose key matches the
+      specified key. */
+      Item_Node<K, V>* entry = Start;
+      while(entry != NULL) {
+        // if entry's key matches the specified key they return that node
+        if(Equal(entry->getKey(), key) == true) { return entry; }
+
+        // Otherwise, move onto the next item
+        entry = entry->getNext();
+      } // while(entry != NULL)
+
+      return NULL;
+    } // Item_Node<K, V>* find(const K& key, const KeyEqual& Equal = KeyEqual()) const {
+
+    /* The same, but Hash is the key's hash. Nodes whose stored hash is
+    different can't have the key, so we only compare keys when the hashes
+    match. */
+    Item_Node<K, V>* find(const K& key, size_t Hash, const KeyEqual& Equal) const {
+      for(Item_Node<K, V>* entry = Start; entry != NULL; entry = entry->getNext()) {
+        if(entry->getHash() == Hash && Equal(entry->getKey(), key) == true) { return entry; }
+      } // for(Item_Node<K, V>* entry = Start; entry != NULL; entry = entry->getNext()) {
+
+      return NULL;
+    } // Item_Node<K, V>* find(const K& key, size_t Hash, const KeyEqual& Equal) const {
+
+  private:
+    /* Remove an item with a particular key from the list. If Use_Hash is
+    true, only nodes whose stored hash is Hash are compared with key. Returns
+    true if an item was removed. */
+    template<typename Allocator>
+    bool Remove(const K& key, bool Use_Hash, size_t Hash, const KeyEqual& Equal, Allocator& Nodes) {
       /* Cycle through the nodes. If we find one whose key matches the specified
       key then remove that item from the list. */
       Item_Node<K, V>* prev = NULL;
@@ -136,7 +547,7 @@ class Item_List {
 
       while(entry != NULL) {
         // If entry's key matches the specified key, remove that node!
-        if(entry->getKey() == key) {
+        if((Use_Hash == false || entry->getHash() == Hash) && Equal(entry->getKey(), key) == true) {
           /* If the first node's key matches the specified key then we just need
           to update Start. Otherwise, we need to have prev the previous node
           point to the node after entry. */
@@ -146,11 +557,17 @@ class Item_List {
             if(Start == End) { Start = End = NULL; }
             else { Start = Start->getNext(); }
           } //   if(entry == Start) {
-          else { prev->setNext(entry->getNext()); }
+          else {
+            prev->setNext(entry->getNext());
+
+            // If we removed the last node then prev is the new last node.
+            if(entry == End) { End = prev; }
+          } // else
 
-          // Now delete the removed node
-          delete entry;
-        } // if(entry->getKey() == key) {
+          // Now delete the removed node. Keys are unique, so we're done.
+          Nodes.deallocate(entry);
+          return true;
+        } // if((Use_Hash == false || entry->getHash() == Hash) && Equal(entry->getKey(), key) == true) {
 
         // Otherwise, move onto the next node
         prev = entry;
@@ -160,34 +577,29 @@ class Item_List {
       /* If we get here then that means that the specified key did not match the
       key of any node in the list. In this case, there is nothing to remove, so
       we're done */
-      return;
-    } // void remove(const K key) {
+      return false;
+    } // bool Remove(const K& key, bool Use_Hash, size_t Hash, const KeyEqual& Equal, Allocator& Nodes) {
 
+  public:
 
-    // Get the value of the node with a particular key. If no such node is
-    // found, then throw an exception.
-    V get(const K key) {
-      /* Search through the items in the list until we find one whose key matches the
-      specified key. If no such key is found, throw an exception. */
-      Item_Node<K, V>* entry = Start;
-      while(entry != NULL) {
-        // if entry's key matches the specified key they return that node's value
-        if(entry->getKey() == key) { return entry->getValue(); }
 
-        // Otherwise, move onto the next item
-        entry = entry->getNext();
-      } // while(entry != NULL)
+    // Get (a reference to) the value of the node with a particular key. If no
+    // such node is found, then throw an exception.
+    V& get(const K& key, const KeyEqual& Equal = KeyEqual()) {
+      Item_Node<K, V>* entry = find(key, Equal);
+      if(entry == NULL) { Throw_Not_In_List(key); }
+      return entry->getValue();
+    } // V& get(const K& key, const KeyEqual& Equal = KeyEqual()) {
 
-      /* If we get here then none of the items in the list had a key that
-      matched the specified key. As such, throw an exception! */
-      char Error_Message_Buffer[500];
-      sprintf(Error_Message_Buffer, "Item Not In List Error: There are no items in this list with key %d\n", key);
-      throw Item_Not_In_List(Error_Message_Buffer);
-    } // V get(const K key) {
+    const V& get(const K& key, const KeyEqual& Equal = KeyEqual()) const {
+      const Item_Node<K, V>* entry = find(key, Equal);
+      if(entry == NULL) { Throw_Not_In_List(key); }
+      return entry->getValue();
+    } // const V& get(const K& key, const KeyEqual& Equal = KeyEqual()) const {
 
 
     // Printing method
-    friend std::ostream& operator<<(std::ostream & os, const Item_List<K, V>& List) {
+    friend std::ostream& operator<<(std::ostream & os, const Item_List& List) {
       Item_Node<K, V>* entry = List.Start;
 
       while(entry != NULL) {
@@ -208,7 +620,7 @@ class Item_List {
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// Hash table
+// Hash table exceptions
 
 // Hash Table exception classes.
 class Hash_Table_Exception {
@@ -226,80 +638,5066 @@ class Invalid_Key: public Hash_Table_Exception {
 
 
 
-template <typename V>
-class Hash_Table {
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Integer hash functions
+
+/* std::hash is the identity for integers, so with Modulo_Growth, keys that are
+all multiples of some stride (e.g. record id * 11) that shares a factor with
+the bucket count end up in just a few buckets. These hash functions mix every
+bit of the key into every bit of the hash (they "avalanche"), so any key
+pattern is spread evenly. Use one as a Hash_Table's Hash parameter, e.g.
+    Hash_Table<unsigned, double, Murmur_Hash<unsigned> >
+
+Each one takes an optional seed. Giving each table its own (e.g. random) seed
+means that a set of keys which collides in one table won't collide in others.
+The seed is passed in through the table's constructor:
+    Hash_Table<unsigned, double, Murmur_Hash<unsigned> > H(11, 1.0, Murmur_Hash<unsigned>(Seed)); */
+
+
+/* Fibonacci hashing: multiply by 2^64 divided by the golden ratio. The high
+bits of the product are well mixed but the low bits aren't (the low bit of the
+product is just the low bit of the key), so we swap the two halves. This is
+the cheapest of the three (one multiply). */
+template<typename K>
+class Fibonacci_Hash {
+  private:
+    uint64_t Seed;
+
+  public:
+    Fibonacci_Hash(uint64_t Seed = 0) : Seed(Seed) {}
+
+    size_t operator()(const K& key) const {
+      uint64_t h = ((uint64_t)key + Seed)*0x9E3779B97F4A7C15ull;
+      return (size_t)((h >> 32) | (h << 32));
+    } // size_t operator()(const K& key) const {
+}; // class Fibonacci_Hash {
+
+
+
+/* MurmurHash3's 64 bit finalizer (fmix64). Two multiplies and three
+xor-shifts, and every input bit affects every output bit. */
+template<typename K>
+class Murmur_Hash {
+  private:
+    uint64_t Seed;
+
+  public:
+    Murmur_Hash(uint64_t Seed = 0) : Seed(Seed) {}
+
+    size_t operator()(const K& key) const {
+      uint64_t h = (uint64_t)key ^ Seed;
+      h ^= h >> 33;
+      h *= 0xFF51AFD7ED558CCDull;
+      h ^= h >> 33;
+      h *= 0xC4CEB9FE1A85EC53ull;
+      h ^= h >> 33;
+      return (size_t)h;
+    } // size_t operator()(const K& key) const {
+}; // class Murmur_Hash {
+
+
+
+/* Multiply two 64 bit numbers and xor the high and low halves of the 128 bit
+product together. This is the mixing step that wyhash is built on. */
+inline uint64_t Multiply_Fold(uint64_t a, uint64_t b) {
+  #if defined(__SIZEOF_INT128__)
+    unsigned __int128 Product = (unsigned __int128)a*b;
+    return (uint64_t)Product ^ (uint64_t)(Product >> 64);
+  #else
+    // Schoolbook multiplication on 32 bit halves.
+    uint64_t a_Lo = (uint32_t)a, a_Hi = a >> 32;
+    uint64_t b_Lo = (uint32_t)b, b_Hi = b >> 32;
+    uint64_t Lo_Lo = a_Lo*b_Lo, Hi_Lo = a_Hi*b_Lo, Lo_Hi = a_Lo*b_Hi, Hi_Hi = a_Hi*b_Hi;
+    uint64_t Cross = (Lo_Lo >> 32) + (uint32_t)Hi_Lo + Lo_Hi;
+    uint64_t Hi = Hi_Hi + (Hi_Lo >> 32) + (Cross >> 32);
+    uint64_t Lo = (Cross << 32) | (uint32_t)Lo_Lo;
+    return Lo ^ Hi;
+  #endif
+} // inline uint64_t Multiply_Fold(uint64_t a, uint64_t b) {
+
+
+/* wyhash style mixing: a single 64x64 -> 128 bit multiply, folded. This is
+about as fast as Fibonacci hashing (on 64 bit machines) but mixes as well as
+Murmur_Hash. */
+template<typename K>
+class Wy_Hash {
+  private:
+    uint64_t Seed;
+
+  public:
+    Wy_Hash(uint64_t Seed = 0) : Seed(Seed) {}
+
+    size_t operator()(const K& key) const {
+      return (size_t)Multiply_Fold((uint64_t)key ^ Seed ^ 0xA0761D6478BD642Full, 0xE7037ED1A0B428DBull);
+    } // size_t operator()(const K& key) const {
+}; // class Wy_Hash {
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Growth policies
+
+/* A growth policy decides how many buckets a table has and how a key's hash is
+turned into a bucket index. Each policy provides:
+    size(N): The number of buckets to use when asked for at least N buckets.
+    grow(N): The number of buckets to ask for when growing a table with N
+      buckets (this is then passed through size).
+    Growth(N): Constructs the policy for a table with N = size(N) buckets.
+    index(Hash): Maps a hash to a bucket index in [0, N).
+The storage engines keep one policy object for their current bucket count. */
+
+
+/* Mix the bits of a hash. Many hash functions (e.g. std::hash for integers)
+are the identity, so all of a key's entropy is left where the key had it. This
+spreads it over every bit of the result. */
+inline uint64_t Mix_Hash(uint64_t h) {
+  h *= 0x9E3779B97F4A7C15ull;
+  return h ^ (h >> 32);
+} // inline uint64_t Mix_Hash(uint64_t h) {
+
+
+
+/* Hash modulo the bucket count. This works with any hash and any bucket count,
+but needs a (slow) integer division on every operation. We keep the bucket
+count odd so that the modulo uses more than just the hash's low bits. */
+class Modulo_Growth {
+  private:
+    unsigned N;
+
+  public:
+    /* I require that there are at least 11 buckets (I just picked a prime
+    number to prevent collissions), and round even bucket counts up to odd. */
+    static unsigned size(unsigned N) { return (N < 11) ? 11 : (N | 1); }
+    static unsigned grow(unsigned N) { return 2*N + 1; }
+
+    Modulo_Growth(unsigned N = 11) : N(N) {}
+    unsigned index(size_t Hash) const { return (unsigned)(Hash % N); }
+}; // class Modulo_Growth {
+
+
+
+/* Power of two bucket counts. The bucket index is just the low bits of the
+(mixed) hash, so this is a multiply, a shift, and a mask instead of a division.
+We have to mix the hash first, since otherwise keys that are all multiples of
+a power of two (a common case) would share a few buckets. */
+class Power_Of_Two_Growth {
+  private:
+    unsigned Mask;
+
+    // The largest power of two that fits in an unsigned.
+    static const unsigned Max_Size = 1u << 31;
+
+    static void Throw_Too_Big() {
+      char Error_Message_Buffer[500];
+      snprintf(Error_Message_Buffer, sizeof(Error_Message_Buffer),
+               "Power_Of_Two_Growth Error: a table can't have more than %u buckets\n", Max_Size);
+      throw std::length_error(Error_Message_Buffer);
+    } // static void Throw_Too_Big() {
+
+  public:
+    /* The smallest power of two (and at least 16) that is at least N. There
+    isn't one above 2^31, so larger N (and growing a table that already has
+    2^31 buckets) throw std::length_error rather than wrapping around. */
+    static unsigned size(unsigned N) {
+      if(N > Max_Size) { Throw_Too_Big(); }
+
+      unsigned Size = 16;
+      while(Size < N) { Size *= 2; }
+      return Size;
+    } // static unsigned size(unsigned N) {
+    static unsigned grow(unsigned N) {
+      if(N > Max_Size/2) { Throw_Too_Big(); }
+      return 2*N;
+    } // static unsigned grow(unsigned N) {
+
+    Power_Of_Two_Growth(unsigned N = 16) : Mask(N - 1) {}
+    unsigned index(size_t Hash) const { return (unsigned)(Mix_Hash(Hash) & Mask); }
+}; // class Power_Of_Two_Growth {
+
+
+
+/* Prime bucket counts (roughly doubling each time). Taking the hash modulo a
+prime uses every bit of the hash, so this works well even with weak hash
+functions. Rather than dividing, we use Lemire's "fastmod": with
+M = ceil(2^64 / N), the remainder a % N is the high 64 bits of the 128 bit
+product (M*a mod 2^64)*N, for any 32 bit a. That's two multiplies. (We fold
+the hash down to 32 bits first.) If the compiler doesn't have 128 bit
+integers, we fall back to %. */
+class Prime_Growth {
+  private:
+    unsigned N;
+    uint64_t M;
+
+    // Primes, each at least 2x + 1 times the previous one.
+    static const unsigned* Primes() {
+      static const unsigned List[] = {
+        11u, 23u, 47u, 97u, 197u, 397u, 797u, 1597u, 3203u, 6421u, 12853u,
+        25717u, 51437u, 102877u, 205759u, 411527u, 823117u, 1646237u,
+        3292489u, 6584983u, 13169977u, 26339969u, 52679969u, 105359939u,
+        210719881u, 421439783u, 842879579u, 1685759167u, 3371518343u,
+        4294967291u};
+      return List;
+    } // static const unsigned* Primes() {
+    static const unsigned N_Primes = 30;
+
+  public:
+    // The smallest prime in our list that is at least N.
+    static unsigned size(unsigned N) {
+      const unsigned* List = Primes();
+      for(unsigned i = 0; i < N_Primes; i++) {
+        if(List[i] >= N) { return List[i]; }
+      } // for(unsigned i = 0; i < N_Primes; i++) {
+      return List[N_Primes - 1];
+    } // static unsigned size(unsigned N) {
+    static unsigned grow(unsigned N) { return 2*N + 1; }
+
+    Prime_Growth(unsigned N = 11) : N(N), M(UINT64_MAX/N + 1) {}
+
+    unsigned index(size_t Hash) const {
+      uint32_t a = (uint32_t)(((uint64_t)Hash) ^ (((uint64_t)Hash) >> 32));
+      #if defined(__SIZEOF_INT128__)
+        return (unsigned)(((unsigned __int128)(M*a)*N) >> 64);
+      #else
+        return a % N;
+      #endif
+    } // unsigned index(size_t Hash) const {
+}; // class Prime_Growth {
+
+
+
+
+
+#if defined(HASH_TABLE_COROUTINES)
+////////////////////////////////////////////////////////////////////////////////
+// Interleaved lookups
+
+/* A lookup that prefetches each address it's about to read and then suspends
+(with co_await Prefetch_And_Suspend{Address}), rather than stalling on the
+cache miss. While it's suspended, the scheduler (Run_Interleaved) resumes
+other lookups, so the misses of several lookups are in flight at once. By the
+time the lookup is resumed, its memory has (hopefully) arrived. */
+struct Prefetch_And_Suspend {
+  const void* Address;
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<>) const noexcept { HASH_TABLE_PREFETCH(Address); }
+  void await_resume() const noexcept {}
+}; // struct Prefetch_And_Suspend {
+
+
+
+/* A coroutine driven by Run_Interleaved. It starts suspended, and stays
+suspended at the end (so that the scheduler can see that it's done) until the
+task is destroyed. If the coroutine throws, the exception is rethrown by
+resume. */
+class Lookup_Task {
+  public:
+    struct promise_type {
+      std::exception_ptr Exception;
+
+      Lookup_Task get_return_object() { return Lookup_Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_always final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { Exception = std::current_exception(); }
+    }; // struct promise_type {
+
+  private:
+    std::coroutine_handle<promise_type> Handle;
+
+    explicit Lookup_Task(std::coroutine_handle<promise_type> Handle) : Handle(Handle) {}
+    Lookup_Task(const Lookup_Task &) = delete;
+    Lookup_Task& operator=(const Lookup_Task &) = delete;
+
+  public:
+    Lookup_Task(Lookup_Task&& Other) noexcept : Handle(Other.Handle) { Other.Handle = nullptr; }
+    ~Lookup_Task() {
+      if(Handle) { Handle.destroy(); }
+    } // ~Lookup_Task() {
+
+    bool done() const { return Handle.done(); }
+
+    void resume() {
+      Handle.resume();
+      if(Handle.promise().Exception) { std::rethrow_exception(Handle.promise().Exception); }
+    } // void resume() {
+}; // class Lookup_Task {
+
+
+
+/* Resume each task in turn (skipping the ones that are done) until they're
+all done. */
+inline void Run_Interleaved(std::vector<Lookup_Task>& Tasks) {
+  unsigned N_Running = (unsigned)Tasks.size();
+  while(N_Running > 0) {
+    N_Running = 0;
+    for(unsigned i = 0; i < Tasks.size(); i++) {
+      if(Tasks[i].done() == true) { continue; }
+
+      Tasks[i].resume();
+      if(Tasks[i].done() == false) { N_Running++; }
+    } // for(unsigned i = 0; i < Tasks.size(); i++) {
+  } // while(N_Running > 0) {
+} // inline void Run_Interleaved(std::vector<Lookup_Task>& Tasks) {
+
+
+
+/* A batch of lookups shared by several lookup tasks. Each task repeatedly
+takes the next key (Next) and looks it up, until every key has been taken.
+Results are reported like search_batch's: Out[i] gets Keys[i]'s value and bit
+i of Found_Mask is set. */
+template<typename K, typename V>
+struct Lookup_Batch {
+  const K* Keys;
+  unsigned N;
+  unsigned Next;
+  V* Out;
+  uint64_t* Found_Mask;
+  unsigned N_Found;
+
+  void found(unsigned i, const V& Value) {
+    Out[i] = Value;
+    Found_Mask[i/64] |= (uint64_t)1 << (i % 64);
+    N_Found++;
+  } // void found(unsigned i, const V& Value) {
+}; // struct Lookup_Batch {
+#endif // #if defined(HASH_TABLE_COROUTINES)
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Chained storage
+
+/* A sorted index of the nodes in a (long) bucket. This is an array of
+pointers to the bucket's nodes, sorted by their stored hashes (see
+Item_Node::getHash), so finding a key takes a binary search for its hash and
+then key comparisons only for nodes with exactly that hash. The nodes
+themselves stay in the bucket's list; the index doesn't own them. */
+template<typename K, typename V>
+class Sorted_Node_Index {
+  private:
+    typedef typename std::vector<Item_Node<K, V>*>::const_iterator Iterator;
+    std::vector<Item_Node<K, V>*> Nodes;   // Sorted by hash
+
+    static bool Hash_Less(const Item_Node<K, V>* Node, size_t Hash) { return Node->getHash() < Hash; }
+    static bool Less_Hash(size_t Hash, const Item_Node<K, V>* Node) { return Hash < Node->getHash(); }
+    static bool Node_Less(const Item_Node<K, V>* a, const Item_Node<K, V>* b) { return a->getHash() < b->getHash(); }
+
+  public:
+    // Index the list of nodes starting at First.
+    explicit Sorted_Node_Index(Item_Node<K, V>* First) {
+      for(Item_Node<K, V>* Node = First; Node != NULL; Node = Node->getNext()) { Nodes.push_back(Node); }
+      std::sort(Nodes.begin(), Nodes.end(), Node_Less);
+    } // explicit Sorted_Node_Index(Item_Node<K, V>* First) {
+
+    unsigned size() const { return (unsigned)Nodes.size(); }
+
+    // The node whose key is key (and whose hash is Hash), or NULL.
+    template<typename KeyEqual>
+    Item_Node<K, V>* find(const K& key, size_t Hash, const KeyEqual& Equal) const {
+      for(Iterator i = std::lower_bound(Nodes.begin(), Nodes.end(), Hash, Hash_Less);
+          i != Nodes.end() && (*i)->getHash() == Hash; ++i) {
+        if(Equal((*i)->getKey(), key) == true) { return *i; }
+      } // for(Iterator i = std::lower_bound(...); ...) {
+
+      return NULL;
+    } // Item_Node<K, V>* find(const K& key, size_t Hash, const KeyEqual& Equal) const {
+
+    // Add a node (which must have its hash set) to the index.
+    void insert(Item_Node<K, V>* Node) {
+      Nodes.insert(std::upper_bound(Nodes.begin(), Nodes.end(), Node->getHash(), Less_Hash), Node);
+    } // void insert(Item_Node<K, V>* Node) {
+
+    // Remove a node (which must be in the index) from the index.
+    void erase(Item_Node<K, V>* Node) {
+      typename std::vector<Item_Node<K, V>*>::iterator i =
+        std::lower_bound(Nodes.begin(), Nodes.end(), Node->getHash(), Hash_Less);
+      while(*i != Node) { ++i; }
+      Nodes.erase(i);
+    } // void erase(Item_Node<K, V>* Node) {
+}; // class Sorted_Node_Index {
+
+
+
+/* Chained storage engine. Each bucket is an Item_List, and every item that
+hashes to a bucket is stored in that bucket's list. Every node comes from the
+table's Node_Pool, so inserts and removes don't go through malloc/free, and
+all of the nodes are freed at once when the table is destroyed.
+
+Each node stores its key's hash. Walking a chain compares hashes and only
+compares keys when they match, and rehashing uses the stored hashes instead
+of hashing every key again.
+
+Long chains are treeified (like Java's HashMap): when an insert finds that its
+bucket has at least Treeify_Threshold items, the bucket gets a
+Sorted_Node_Index, and lookups in that bucket use a binary search rather than
+walking the chain. A bucket's index is dropped when removes shrink it to
+Untreeify_Threshold items, or when nodes are moved into it by a rehash (the
+next insert that finds it too long treeifies it again). Removing an item from
+a treeified bucket still walks the chain, but only compares hashes. */
+template <typename K, typename V, typename KeyHash, typename KeyEqual, typename Growth>
+class Chained_Storage {
   private:
+    typedef Item_List<K, V, KeyEqual> Bucket;
+    typedef Sorted_Node_Index<K, V> Bucket_Index;
+
     unsigned N_Buckets;
-    Item_List<unsigned, V>* Buckets;
+    Bucket* Buckets;
+    Growth Policy;                         // Maps hashes to bucket indices
+    Node_Pool<K, V> Nodes;                 // Where every node comes from
+
+    KeyHash Hasher;
+    KeyEqual Key_Equal;
+
+    unsigned N_Items;                      // Number of items in the table
+    float Max_Load_Factor;                 // Largest allowed N_Items/N_Buckets
+
+    /* The index of each treeified bucket in Buckets (NULL for buckets that
+    are plain lists). Indices itself is NULL until a bucket is treeified. */
+    Bucket_Index** Indices;
+
+    /* Incremental rehashing state. While an incremental rehash is in progress,
+    Old_Buckets holds the bucket array we're migrating away from and every
+    old bucket before Migrate_Index has been emptied into Buckets. When
+    Rehash_Step is 0, the table rehashes all at once instead. Only updates
+    migrate buckets; lookups check both arrays (so, as the comment on the
+    concurrent tables says, several threads can still look things up at
+    once). */
+    Bucket* Old_Buckets;
+    unsigned Old_N_Buckets;
+    Growth Old_Policy;
+    unsigned Migrate_Index;
+    unsigned Rehash_Step;                  // Old buckets migrated per operation
 
     // Hashing function
-    unsigned Hash(unsigned key) const { return (key % N_Buckets); }
+    unsigned Hash(const K& key) const { return Policy.index(Hasher(key)); }
 
-    // Delete the implicit = operator and copy constructor methods
-    Hash_Table(const Hash_Table &) = delete;
-    Hash_Table& operator=(const Hash_Table &) = delete;
 
-  public:
-    // Constructor, destructor
-    Hash_Table(unsigned N_Buckets = 11) {
-      /* I require that there are at least 11 buckets (I just picked a prime
-      number to prevent collissions) */
-      if(N_Buckets < 11) { N_Buckets = 11; }
+    /* Relink every node in From into its bucket in Buckets. No nodes are
+    reallocated, and no keys are hashed (we use each node's stored hash). A
+    bucket that gets a node this way loses its index (if it had one), since
+    adding to an index can allocate, and remove migrates buckets. */
+    void Migrate_Bucket(Bucket& From) {
+      /* Detach the bucket's nodes and then link each one into its new bucket.
+      We need to get each node's Next before linking it, since linking resets
+      Next. */
+      Item_Node<K, V>* entry = From.release();
+      while(entry != NULL) {
+        Item_Node<K, V>* Next = entry->getNext();
+        unsigned i = Policy.index(entry->getHash());
+        Buckets[i].link(entry);
+        Untreeify(i);
+        entry = Next;
+      } // while(entry != NULL) {
+    } // void Migrate_Bucket(Bucket& From) {
 
-      Hash_Table::N_Buckets = N_Buckets;
-      Buckets = new Item_List<unsigned, V>[N_Buckets];
-    } // Hash_Table(unsigned N_Buckets = 11) {
 
-    ~Hash_Table() { delete [] Buckets; }
+    // Give bucket i an index (if it doesn't have one).
+    void Treeify(unsigned i) {
+      if(Indices == NULL) { Indices = new Bucket_Index*[N_Buckets](); }
+      if(Indices[i] == NULL) { Indices[i] = new Bucket_Index(Buckets[i].first()); }
+    } // void Treeify(unsigned i) {
 
+    // Drop bucket i's index (if it has one).
+    void Untreeify(unsigned i) {
+      if(Indices == NULL || Indices[i] == NULL) { return; }
+      delete Indices[i];
+      Indices[i] = NULL;
+    } // void Untreeify(unsigned i) {
 
-    // Insert an item into the table.
-    void insert(unsigned key, V value) {
-      // First, calculate the key of the hash
-      unsigned bucket_index = Hash(key);
+    // Drop every bucket's index. We do this whenever we replace Buckets.
+    void Clear_Indices() {
+      if(Indices == NULL) { return; }
+      for(unsigned i = 0; i < N_Buckets; i++) { delete Indices[i]; }
+      delete [] Indices;
+      Indices = NULL;
+    } // void Clear_Indices() {
 
-      // Now, add the new key-value pair into the selected bucket.
-      Buckets[bucket_index].put(key, value);
-    } // void insert(unsigned key, V value) {
+    // Bucket i's index (or NULL if it isn't treeified).
+    Bucket_Index* Index_Of(unsigned i) const { return (Indices == NULL) ? NULL : Indices[i]; }
 
 
-    // remove the value with the specified key from the table.
-    void remove(unsigned key) {
-      // Calculate the bucket index.
-      unsigned bucket_index = Hash(key);
+    /* The node in bucket i with the specified key (whose hash is Key_Hash),
+    or NULL. If the bucket isn't treeified, this sets Length to the number of
+    nodes we looked at. */
+    Item_Node<K, V>* Find_Node(unsigned i, const K& key, size_t Key_Hash, unsigned& Length) const {
+      Length = 0;
+      Bucket_Index* Index = Index_Of(i);
+      if(Index != NULL) { return Index->find(key, Key_Hash, Key_Equal); }
 
-      // Remove the item with the specified key from the selected bucket
-      Buckets[bucket_index].remove(key);
-    } // void remove(unsigned key) {
+      for(Item_Node<K, V>* Node = Buckets[i].first(); Node != NULL; Node = Node->getNext()) {
+        Length++;
+        if(Node->getHash() == Key_Hash && Key_Equal(Node->getKey(), key) == true) { return Node; }
+      } // for(Item_Node<K, V>* Node = Buckets[i].first(); Node != NULL; Node = Node->getNext()) {
 
+      return NULL;
+    } // Item_Node<K, V>* Find_Node(unsigned i, const K& key, size_t Key_Hash, unsigned& Length) const {
 
-    /* Find the value of the item with the specified key. Throws an exception
-    if no item with the specified key can be found */
-    V search(unsigned key) const {
-      // First, find the bucket index.
-      unsigned bucket_index = Hash(key);
-
-      // Now, try finding an item with the specified key in the selected bucket.
-      try { return Buckets[bucket_index].get(key); }
-      catch (const Item_Not_In_List& Er ) {
-        /* If no item with the specified value can be found, then we raise an
-        Invalid_Key exception. */
-        char Error_Message_Buffer[500];
-        sprintf(Error_Message_Buffer,
-                "Invalid Key Error: This hash table does not have an entry with key %d\n",
-                key);
-        throw Invalid_Key(Error_Message_Buffer);
-      } // catch (const Item_Not_In_List& Er ) {
-    } // V search(unsigned key) const {
+    /* The node with the specified key in its old bucket, or NULL (including
+    when there is no incremental rehash in progress). Old buckets are never
+    treeified, and the ones that have been migrated are empty. */
+    Item_Node<K, V>* Find_Old_Node(const K& key, size_t Key_Hash) const {
+      if(Old_Buckets == NULL) { return NULL; }
 
+      for(Item_Node<K, V>* Node = Old_Buckets[Old_Policy.index(Key_Hash)].first(); Node != NULL; Node = Node->getNext()) {
+        if(Node->getHash() == Key_Hash && Key_Equal(Node->getKey(), key) == true) { return Node; }
+      } // for(Item_Node<K, V>* Node = Old_Buckets[Old_Policy.index(Key_Hash)].first(); ...
+      return NULL;
+    } // Item_Node<K, V>* Find_Old_Node(const K& key, size_t Key_Hash) const {
 
-    // Printing method
-    friend std::ostream & operator<<(std::ostream & os, const Hash_Table & Table) {
-      unsigned N_Buckets = Table.N_Buckets;
-      for(unsigned i = 0; i < N_Buckets; i++) {
-        os << "Bucket " << i << ": " << Table.Buckets[i] << std::endl;
-      } // for(unsigned i = 0; i < N_Buckets; i++) {
 
-      return os;
-    } // friend std::ostream & operator<<(std::ostream & os, const Hash_Table & Table) {
-}; // class Hash_Table {
+    /* If an incremental rehash is in progress then do a bounded amount of it.
+    First, we migrate the old bucket that the key (whose hash is Key_Hash)
+    hashed to. After this, every item with that key is in Buckets, so the
+    caller only needs to consult the new array. Then we migrate the next
+    Step old buckets. Once every old bucket has been migrated, we free the old
+    array. Updates call this; lookups don't (see Find_Value).
+
+    Step is Rehash_Step, unless that's too slow to finish before the table
+    fills up (which happens when the max load factor is below 1, since then
+    there are fewer inserts than old buckets until the next growth). In that
+    case we spread the remaining old buckets evenly over the inserts that are
+    left, so the migration is done by the time the table is full again and
+    the next growth never has to finish it in one go. */
+    void Migrate_Step(size_t Key_Hash) {
+      if(Old_Buckets == NULL) { return; }
+
+      Migrate_Bucket(Old_Buckets[Old_Policy.index(Key_Hash)]);
+
+      unsigned Max_Items = (unsigned)(Max_Load_Factor*N_Buckets);
+      unsigned Inserts_Left = (N_Items < Max_Items) ? Max_Items - N_Items : 1;
+      unsigned Remaining = Old_N_Buckets - Migrate_Index;
+      unsigned Step = std::max(Rehash_Step, (Remaining + Inserts_Left - 1)/Inserts_Left);
+
+      for(unsigned i = 0; i < Step && Migrate_Index < Old_N_Buckets; i++) {
+        Migrate_Bucket(Old_Buckets[Migrate_Index]);
+        Migrate_Index++;
+      } // for(unsigned i = 0; i < Step && Migrate_Index < Old_N_Buckets; i++) {
+
+      if(Migrate_Index == Old_N_Buckets) { Finish_Rehash(); }
+    } // void Migrate_Step(size_t Key_Hash) {
+
+
+    // Migrate every remaining old bucket, then free the old array.
+    void Finish_Rehash() {
+      if(Old_Buckets == NULL) { return; }
+
+      for(; Migrate_Index < Old_N_Buckets; Migrate_Index++) {
+        Migrate_Bucket(Old_Buckets[Migrate_Index]);
+      } // for(; Migrate_Index < Old_N_Buckets; Migrate_Index++) {
+
+      // The old buckets are now empty, so this won't free any nodes.
+      Free_Buckets(Old_Buckets);
+      Old_Buckets = NULL;
+      Old_N_Buckets = 0;
+      Migrate_Index = 0;
+    } // void Finish_Rehash() {
+
+
+    /* If the load factor exceeds the max load factor then grow the table. We
+    (roughly) double the number of buckets each time so that the cost of
+    rehashing is amortized over the inserts that filled the table. The exact
+    bucket counts we use are up to the growth policy.
+
+    If incremental rehashing is enabled then we just allocate the new buckets
+    here. The items are migrated a few buckets at a time by later operations
+    (see Migrate_Step), which finish before the table fills up again. The new
+    array comes from Allocate_Buckets, so we don't construct it here either. */
+    void Grow_If_Needed() {
+      if(Rehash_Step == 0) {
+        while(N_Items > Max_Load_Factor*N_Buckets) { rehash(Growth::grow(N_Buckets)); }
+        return;
+      } // if(Rehash_Step == 0) {
+
+      if(N_Items <= Max_Load_Factor*N_Buckets) { return; }
+
+      /* We can only migrate away from one old array at a time, so if the
+      previous incremental rehash hasn't finished yet, finish it now. Migrate_Step
+      paces the migration so that this only happens when the max load factor
+      was lowered in the middle of it. */
+      Finish_Rehash();
+
+      unsigned New_N_Buckets = Growth::size(Growth::grow(N_Buckets));
+      while(N_Items > Max_Load_Factor*New_N_Buckets) {
+        New_N_Buckets = Growth::size(Growth::grow(New_N_Buckets));
+      } // while(N_Items > Max_Load_Factor*New_N_Buckets) {
+
+      // Allocate first, so that if it throws, the table is left as it was.
+      Bucket* New_Buckets = Allocate_Buckets(New_N_Buckets);
+
+      Old_Buckets = Buckets;
+      Old_N_Buckets = N_Buckets;
+      Old_Policy = Policy;
+      Migrate_Index = 0;
+
+      Clear_Indices();
+      Buckets = New_Buckets;
+      N_Buckets = New_N_Buckets;
+      Policy = Growth(N_Buckets);
+    } // void Grow_If_Needed() {
+
+    /* Allocate an array of N empty buckets. An empty Item_List is all zero
+    bits, so rather than constructing every bucket we get zeroed memory from
+    calloc. Big arrays then come straight from the OS as zero pages, which are
+    only touched when a bucket is first used, so growing the table doesn't pay
+    for the whole new array at once. Arrays from here are freed (once they're
+    empty) with Free_Buckets, which doesn't run the buckets' destructors. */
+    static Bucket* Allocate_Buckets(unsigned N) {
+      Bucket* Array = static_cast<Bucket*>(calloc(N, sizeof(Bucket)));
+      if(Array == NULL) { throw std::bad_alloc(); }
+      return Array;
+    } // static Bucket* Allocate_Buckets(unsigned N) {
+
+    static void Free_Buckets(Bucket* Array) { free(Array); }
+
+    /* Empty every bucket in an array before it's freed (Free_Buckets doesn't
+    run the buckets' destructors, so this is where the items are destroyed).
+    If nodes are trivially
+    destructible then there's nothing to destroy, so we just detach them and
+    let the pool free their memory in bulk. */
+    void Clear_Buckets(Bucket* Array, unsigned N) {
+      if(Array == NULL) { return; }
+
+      for(unsigned i = 0; i < N; i++) {
+        if(std::is_trivially_destructible< Item_Node<K, V> >::value == true) { Array[i].release(); }
+        else { Array[i].clear(Nodes); }
+      } // for(unsigned i = 0; i < N; i++) {
+    } // void Clear_Buckets(Bucket* Array, unsigned N) {
+
+    /* Pointer to the value of the item with the specified key (or NULL). This
+    doesn't change the table: if an incremental rehash is in progress and the
+    key isn't in the new array, we look in its old bucket too. */
+    V* Find_Value(const K& key) const {
+      size_t Key_Hash = Hasher(key);
+
+      unsigned Length;
+      Item_Node<K, V>* Node = Find_Node(Policy.index(Key_Hash), key, Key_Hash, Length);
+      if(Node == NULL) { Node = Find_Old_Node(key, Key_Hash); }
+      return (Node == NULL) ? NULL : &Node->getItem().value;
+    } // V* Find_Value(const K& key) const {
+
+    // Delete the implicit = operator and copy constructor methods
+    Chained_Storage(const Chained_Storage &) = delete;
+    Chained_Storage& operator=(const Chained_Storage &) = delete;
+
+  public:
+    // Constructor, destructor
+    Chained_Storage(unsigned N_Buckets = 11, float Max_Load_Factor = 1.0,
+                    const KeyHash& Hasher = KeyHash(), const KeyEqual& Key_Equal = KeyEqual())
+        : Hasher(Hasher), Key_Equal(Key_Equal),
+          N_Items(0), Indices(NULL), Old_Buckets(NULL), Old_N_Buckets(0), Migrate_Index(0), Rehash_Step(0) {
+      // The growth policy decides the actual number of buckets.
+      N_Buckets = Growth::size(N_Buckets);
+
+      // A non-positive load factor makes no sense, so use the default.
+      if(Max_Load_Factor <= 0) { Max_Load_Factor = 1.0; }
+
+      Chained_Storage::N_Buckets = N_Buckets;
+      Chained_Storage::Max_Load_Factor = Max_Load_Factor;
+      Buckets = Allocate_Buckets(N_Buckets);
+      Policy = Growth(N_Buckets);
+    } // Chained_Storage(unsigned N_Buckets = 11, float Max_Load_Factor = 1.0) {
+
+    ~Chained_Storage() {
+      Clear_Indices();
+      Clear_Buckets(Buckets, N_Buckets);
+      Clear_Buckets(Old_Buckets, Old_N_Buckets);
+
+      Free_Buckets(Old_Buckets);
+      Free_Buckets(Buckets);
+
+      // Nodes' destructor now frees every slab.
+    } // ~Chained_Storage() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned size() const { return N_Items; }
+    unsigned bucket_count() const { return N_Buckets; }
+    float load_factor() const { return ((float)N_Items)/N_Buckets; }
+
+    /* Number of items in the i'th bucket (of the current bucket array). This
+    walks the bucket's list (unless it's treeified). */
+    unsigned bucket_size(unsigned i) const {
+      Bucket_Index* Index = Index_Of(i);
+      return (Index == NULL) ? Buckets[i].size() : Index->size();
+    } // unsigned bucket_size(unsigned i) const {
+
+    // Returns true if the i'th bucket (of the current bucket array) is treeified.
+    bool treeified(unsigned i) const { return Index_Of(i) != NULL; }
+
+    /* Buckets with at least this many items are treeified by the next insert
+    into them, and treeified buckets that shrink to Untreeify_Threshold items
+    go back to being plain lists. */
+    static const unsigned Treeify_Threshold = 8;
+    static const unsigned Untreeify_Threshold = 6;
+
+    // The bucket (of the current bucket array) that key hashes to
+    unsigned bucket(const K& key) const { return Hash(key); }
+
+
+    /* Prefetch what a lookup of key will read. Batched lookups call this for
+    a group of keys in each stage (0 up to Prefetch_Stages - 1) before looking
+    any of them up. Stage 0 prefetches the key's bucket, and stage 1 (once the
+    bucket has arrived) prefetches the first node in its chain. Later nodes in
+    long chains aren't prefetched. */
+    static const unsigned Prefetch_Stages = 2;
+    void prefetch(const K& key, unsigned Stage) const {
+      const Bucket& Key_Bucket = Buckets[Hash(key)];
+      if(Stage == 0) { HASH_TABLE_PREFETCH(&Key_Bucket); }
+      else { HASH_TABLE_PREFETCH(Key_Bucket.first()); }
+    } // void prefetch(const K& key, unsigned Stage) const {
+
+
+    #if defined(HASH_TABLE_COROUTINES)
+      /* A lookup task (see Lookup_Task) that looks up keys from Batch until
+      there are none left. This is find, except that it suspends before
+      reading each bucket and before reading each node, so that several of
+      these can run interleaved. Like find, it looks in the key's new bucket
+      and then (during an incremental rehash) its old bucket, and never
+      changes the table, so nothing moves while a task is suspended. */
+      Lookup_Task lookup_task(Lookup_Batch<K, V>& Batch) const {
+        while(Batch.Next < Batch.N) {
+          unsigned i = Batch.Next++;
+          const K& key = Batch.Keys[i];
+          size_t Key_Hash = Hasher(key);
+
+          const Bucket* Key_Buckets[2] = {&Buckets[Policy.index(Key_Hash)], NULL};
+          if(Old_Buckets != NULL) { Key_Buckets[1] = &Old_Buckets[Old_Policy.index(Key_Hash)]; }
+
+          bool Found = false;
+          for(unsigned b = 0; b < 2 && Found == false && Key_Buckets[b] != NULL; b++) {
+            co_await Prefetch_And_Suspend{Key_Buckets[b]};
+
+            for(Item_Node<K, V>* Node = Key_Buckets[b]->first(); Node != NULL; Node = Node->getNext()) {
+              co_await Prefetch_And_Suspend{Node};
+              if(Node->getHash() == Key_Hash && Key_Equal(Node->getKey(), key) == true) {
+                Batch.found(i, Node->getValue());
+                Found = true;
+                break;
+              } // if(Node->getHash() == Key_Hash && Key_Equal(Node->getKey(), key) == true) {
+            } // for(Item_Node<K, V>* Node = Key_Buckets[b]->first(); Node != NULL; Node = Node->getNext()) {
+          } // for(unsigned b = 0; b < 2 && Found == false && Key_Buckets[b] != NULL; b++) {
+        } // while(Batch.Next < Batch.N) {
+      } // Lookup_Task lookup_task(Lookup_Batch<K, V>& Batch) const {
+    #endif
+
+    float max_load_factor() const { return Max_Load_Factor; }
+
+    /* Make room for N items: grow the bucket array so that N items won't
+    exceed the max load factor, and get N nodes ready in the node pool. After
+    this, inserting until there are N items won't rehash or allocate nodes. */
+    void reserve(unsigned N) {
+      unsigned New_N_Buckets = (unsigned)(N/Max_Load_Factor) + 1;
+      if(New_N_Buckets > N_Buckets) { rehash(New_N_Buckets); }
+      if(N > N_Items) { Nodes.reserve(N - N_Items); }
+    } // void reserve(unsigned N) {
+
+    /* Set the max load factor. If the table is already fuller than the new
+    max load factor then it is grown immediately. */
+    void max_load_factor(float New_Max_Load_Factor) {
+      if(New_Max_Load_Factor <= 0) { return; }
+      Max_Load_Factor = New_Max_Load_Factor;
+      Grow_If_Needed();
+    } // void max_load_factor(float New_Max_Load_Factor) {
+
+
+    /* Incremental rehashing. By default (Rehash_Step == 0) the table moves
+    every item into the new bucket array as soon as it grows. If Rehash_Step is
+    positive then the table instead keeps both bucket arrays around and
+    migrates at least Rehash_Step old buckets on each insert and remove
+    (lookups look in both arrays, and don't migrate anything). Each migration
+    is paced to finish before the table next grows. This spreads the cost of
+    growing over many operations so no single operation has to pay for the
+    whole resize. */
+    unsigned rehash_step() const { return Rehash_Step; }
+    void rehash_step(unsigned New_Rehash_Step) {
+      Rehash_Step = New_Rehash_Step;
+
+      // If we just turned incremental rehashing off, finish any migration.
+      if(Rehash_Step == 0) { Finish_Rehash(); }
+    } // void rehash_step(unsigned New_Rehash_Step) {
+
+    // Returns true if an incremental rehash is in progress.
+    bool rehashing() const { return Old_Buckets != NULL; }
+
+
+    /* Move every item into a new array of New_N_Buckets buckets (rounded by
+    the growth policy). The existing nodes are relinked into their new
+    buckets, so no items are reallocated. This always rehashes all at once
+    (finishing any incremental rehash that is in progress first). */
+    void rehash(unsigned New_N_Buckets) {
+      New_N_Buckets = Growth::size(New_N_Buckets);
+      Finish_Rehash();
+
+      Bucket* Previous_Buckets = Buckets;
+      unsigned Previous_N_Buckets = N_Buckets;
+
+      // Hash uses the policy, so update it before moving nodes.
+      Clear_Indices();
+      Buckets = Allocate_Buckets(New_N_Buckets);
+      N_Buckets = New_N_Buckets;
+      Policy = Growth(N_Buckets);
+
+      for(unsigned i = 0; i < Previous_N_Buckets; i++) {
+        Migrate_Bucket(Previous_Buckets[i]);
+      } // for(unsigned i = 0; i < Previous_N_Buckets; i++) {
+
+      // The old buckets are now empty, so this won't free any nodes.
+      Free_Buckets(Previous_Buckets);
+    } // void rehash(unsigned New_N_Buckets) {
+
+
+    /* If no item has the specified key, add one whose value is constructed
+    (in its node) from args. Returns a pointer to the key's value and true if
+    the item is new. If the key was already in the table, args are left alone.
+    key should be a K (or reference to one). */
+    template<typename Key_Arg, typename... Args>
+    std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+      // First, calculate the key's hash. We only do this once.
+      size_t Key_Hash = Hasher(key);
+
+      // Do some of the incremental rehash (if one is in progress).
+      Migrate_Step(Key_Hash);
+      unsigned bucket_index = Policy.index(Key_Hash);
+
+      // If the key is already in the table, we're done.
+      unsigned Length;
+      Item_Node<K, V>* Node = Find_Node(bucket_index, key, Key_Hash, Length);
+      if(Node != NULL) { return std::pair<V*, bool>(&Node->getValue(), false); }
+
+      // If the bucket is too long (and not yet treeified), treeify it.
+      if(Length >= Treeify_Threshold) { Treeify(bucket_index); }
+
+      /* Now, add the new item to the end of the selected bucket (and its
+      index, if it has one). If indexing the node throws, give it back. */
+      Node = Nodes.allocate(std::forward<Key_Arg>(key), std::forward<Args>(args)...);
+      Node->setHash(Key_Hash);
+
+      Bucket_Index* Index = Index_Of(bucket_index);
+      if(Index != NULL) {
+        try { Index->insert(Node); }
+        catch(...) {
+          Nodes.deallocate(Node);
+          throw;
+        } // catch(...) {
+      } // if(Index != NULL) {
+      Buckets[bucket_index].link(Node);
+
+      /* The table may need to grow. Nodes never move, so the value pointer
+      stays valid. */
+      N_Items++;
+      Grow_If_Needed();
+      return std::pair<V*, bool>(&Node->getValue(), true);
+    } // std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      size_t Key_Hash = Hasher(key);
+      Migrate_Step(Key_Hash);
+
+      // Calculate the bucket index.
+      unsigned bucket_index = Policy.index(Key_Hash);
+
+      /* If the bucket is treeified, take the node out of the index first (if
+      it's there), and go back to a plain list if the bucket is now short. */
+      Bucket_Index* Index = Index_Of(bucket_index);
+      if(Index != NULL) {
+        Item_Node<K, V>* Node = Index->find(key, Key_Hash, Key_Equal);
+        if(Node == NULL) { return; }
+
+        Index->erase(Node);
+        if(Index->size() <= Untreeify_Threshold) { Untreeify(bucket_index); }
+      } // if(Index != NULL) {
+
+      // Remove the item with the specified key from the selected bucket
+      if(Buckets[bucket_index].remove(key, Key_Hash, Key_Equal, Nodes) == true) { N_Items--; }
+    } // void remove(const K& key) {
+
+
+    /* Find the value of the item with the specified key. Returns NULL if no
+    item has that key. */
+    V* find(const K& key) { return Find_Value(key); }
+    const V* find(const K& key) const { return Find_Value(key); }
+
+
+    // Printing method
+    friend std::ostream & operator<<(std::ostream & os, const Chained_Storage & Table) {
+      unsigned N_Buckets = Table.N_Buckets;
+      for(unsigned i = 0; i < N_Buckets; i++) {
+        os << "Bucket " << i << ": " << Table.Buckets[i] << std::endl;
+      } // for(unsigned i = 0; i < N_Buckets; i++) {
+
+      // If we're partway through an incremental rehash, print the old buckets too.
+      for(unsigned i = Table.Migrate_Index; i < Table.Old_N_Buckets; i++) {
+        os << "Old Bucket " << i << ": " << Table.Old_Buckets[i] << std::endl;
+      } // for(unsigned i = Table.Migrate_Index; i < Table.Old_N_Buckets; i++) {
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Chained_Storage & Table) {
+}; // class Chained_Storage {
+
+template <typename K, typename V, typename KeyHash, typename KeyEqual, typename Growth>
+const unsigned Chained_Storage<K, V, KeyHash, KeyEqual, Growth>::Treeify_Threshold;
+template <typename K, typename V, typename KeyHash, typename KeyEqual, typename Growth>
+const unsigned Chained_Storage<K, V, KeyHash, KeyEqual, Growth>::Untreeify_Threshold;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Unrolled chains
+
+// x rounded up to a multiple of Multiple
+constexpr unsigned Round_Up(size_t x, size_t Multiple) { return (unsigned)((x + Multiple - 1)/Multiple*Multiple); }
+
+/* Largest number of items (at most N) whose keys, then values, then a next
+pointer and a count fit in Size bytes. This is always at least 1. */
+constexpr unsigned Items_Per_Chunk(size_t Key_Size, size_t Value_Size, size_t Value_Alignment,
+                                   size_t Size, unsigned N = 64) {
+  return (N <= 1) ? 1 :
+         (Round_Up(Round_Up(N*Key_Size, Value_Alignment) + N*Value_Size, alignof(void*)) +
+            sizeof(void*) + sizeof(unsigned) <= Size) ? N :
+         Items_Per_Chunk(Key_Size, Value_Size, Value_Alignment, Size, N - 1);
+} // constexpr unsigned Items_Per_Chunk(...) {
+
+
+
+/* A chunk of an unrolled bucket list. Rather than one node per item, a chunk
+holds up to Capacity items: all of its keys next to each other, then all of
+its values, then one pointer to the next chunk. Capacity is however many items
+fit in one 64 byte cache line (or 1 if even one doesn't fit), and chunks are
+cache line aligned, so checking every key in a chunk reads one cache line.
+Only the first Count keys and values are constructed. */
+template<typename K, typename V>
+struct alignas(64) Unrolled_Chunk {
+  static const unsigned Capacity = Items_Per_Chunk(sizeof(K), sizeof(V), alignof(V), 64);
+
+  typename std::aligned_storage<sizeof(K), alignof(K)>::type Keys[Capacity];
+  typename std::aligned_storage<sizeof(V), alignof(V)>::type Values[Capacity];
+  Unrolled_Chunk* Next;
+  unsigned Count;
+
+  K& key(unsigned i) { return *reinterpret_cast<K*>(&Keys[i]); }
+  const K& key(unsigned i) const { return *reinterpret_cast<const K*>(&Keys[i]); }
+  V& value(unsigned i) { return *reinterpret_cast<V*>(&Values[i]); }
+  const V& value(unsigned i) const { return *reinterpret_cast<const V*>(&Values[i]); }
+
+  // Destroy the i'th item (its storage is left as is).
+  void destroy(unsigned i) {
+    key(i).~K();
+    value(i).~V();
+  } // void destroy(unsigned i) {
+}; // struct Unrolled_Chunk {
+
+template<typename K, typename V>
+const unsigned Unrolled_Chunk<K, V>::Capacity;
+
+
+
+/* Unrolled chained storage engine. Like Chained_Storage, each bucket is a
+linked list, but the list is a list of chunks (see Unrolled_Chunk) rather
+than of single items. A bucket with a few colliding keys keeps them in one
+cache line instead of scattering them over several nodes, and there's one next
+pointer per chunk instead of one per item. Chunks come from a Slab_Pool.
+
+Every chunk in a bucket except the first one is full. New items go into the
+first chunk (and if it's full, a new first chunk is added). When an item is
+removed, the first chunk's last item moves into its place. This means that
+items move when other items are removed or the table is rehashed, so pointers
+to values are only good until then. Since chunks hold several items, the
+default max load factor is 2. */
+template <typename K, typename V, typename KeyHash, typename KeyEqual, typename Growth>
+class Unrolled_Storage {
+  private:
+    typedef Unrolled_Chunk<K, V> Chunk;
+
+    unsigned N_Buckets;
+    Chunk** Buckets;                       // First chunk of each bucket (NULL if empty)
+    Growth Policy;                         // Maps hashes to bucket indices
+    Slab_Pool<Chunk> Chunks;               // Where every chunk comes from
+
+    KeyHash Hasher;
+    KeyEqual Key_Equal;
+
+    unsigned N_Items;                      // Number of items in the table
+    float Max_Load_Factor;                 // Largest allowed N_Items/N_Buckets
+
+    // Hashing function
+    unsigned Hash(const K& key) const { return Policy.index(Hasher(key)); }
+
+
+    /* Returns the chunk holding the item with the specified key, and sets i to
+    the item's index in that chunk. Returns NULL if there is no such item. */
+    Chunk* Find_Item(const K& key, unsigned& i) const {
+      for(Chunk* C = Buckets[Hash(key)]; C != NULL; C = C->Next) {
+        for(i = 0; i < C->Count; i++) {
+          if(Key_Equal(C->key(i), key) == true) { return C; }
+        } // for(i = 0; i < C->Count; i++) {
+      } // for(Chunk* C = Buckets[Hash(key)]; C != NULL; C = C->Next) {
+
+      return NULL;
+    } // Chunk* Find_Item(const K& key, unsigned& i) const {
+
+
+    /* Returns bucket b's first chunk if it has room for another item.
+    Otherwise, adds a new (empty) first chunk and returns that. */
+    Chunk* Chunk_With_Room(unsigned b) {
+      Chunk* First = Buckets[b];
+      if(First != NULL && First->Count < Chunk::Capacity) { return First; }
+
+      Chunk* New_Chunk = new (Chunks.allocate()) Chunk;
+      New_Chunk->Next = First;
+      New_Chunk->Count = 0;
+      Buckets[b] = New_Chunk;
+      return New_Chunk;
+    } // Chunk* Chunk_With_Room(unsigned b) {
+
+
+    // If bucket b's first chunk is empty, free it.
+    void Free_First_If_Empty(unsigned b) {
+      Chunk* First = Buckets[b];
+      if(First->Count != 0) { return; }
+
+      Buckets[b] = First->Next;
+      Chunks.deallocate(First);
+    } // void Free_First_If_Empty(unsigned b) {
+
+
+    /* Remove item i of chunk C (which is in bucket b). The bucket's last item
+    (the last item in its first chunk) moves into the hole, so every chunk but
+    the first stays full. */
+    void Remove_Item(unsigned b, Chunk* C, unsigned i) {
+      Chunk* First = Buckets[b];
+      unsigned Last = First->Count - 1;
+
+      C->destroy(i);
+      if(C != First || i != Last) {
+        new (&C->Keys[i]) K(std::move(First->key(Last)));
+        new (&C->Values[i]) V(std::move(First->value(Last)));
+        First->destroy(Last);
+      } // if(C != First || i != Last) {
+
+      First->Count--;
+      Free_First_If_Empty(b);
+    } // void Remove_Item(unsigned b, Chunk* C, unsigned i) {
+
+
+    // Delete the implicit = operator and copy constructor methods
+    Unrolled_Storage(const Unrolled_Storage &) = delete;
+    Unrolled_Storage& operator=(const Unrolled_Storage &) = delete;
+
+  public:
+    // Constructor, destructor
+    Unrolled_Storage(unsigned N_Buckets = 11, float Max_Load_Factor = 2.0,
+                     const KeyHash& Hasher = KeyHash(), const KeyEqual& Key_Equal = KeyEqual())
+        : Hasher(Hasher), Key_Equal(Key_Equal), N_Items(0) {
+      // The growth policy decides the actual number of buckets.
+      N_Buckets = Growth::size(N_Buckets);
+
+      // A non-positive load factor makes no sense, so use the default.
+      if(Max_Load_Factor <= 0) { Max_Load_Factor = 2.0; }
+
+      Unrolled_Storage::N_Buckets = N_Buckets;
+      Unrolled_Storage::Max_Load_Factor = Max_Load_Factor;
+      Buckets = new Chunk*[N_Buckets]();
+      Policy = Growth(N_Buckets);
+    } // Unrolled_Storage(unsigned N_Buckets = 11, float Max_Load_Factor = 2.0) {
+
+    ~Unrolled_Storage() {
+      // The pool frees the chunks themselves, so we just need to destroy the items.
+      if(std::is_trivially_destructible<K>::value == false || std::is_trivially_destructible<V>::value == false) {
+        for(unsigned b = 0; b < N_Buckets; b++) {
+          for(Chunk* C = Buckets[b]; C != NULL; C = C->Next) {
+            for(unsigned i = 0; i < C->Count; i++) { C->destroy(i); }
+          } // for(Chunk* C = Buckets[b]; C != NULL; C = C->Next) {
+        } // for(unsigned b = 0; b < N_Buckets; b++) {
+      } // if(std::is_trivially_destructible<K>::value == false || ...
+
+      delete [] Buckets;
+    } // ~Unrolled_Storage() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned size() const { return N_Items; }
+    unsigned bucket_count() const { return N_Buckets; }
+    float load_factor() const { return ((float)N_Items)/N_Buckets; }
+
+    // Number of items in the i'th bucket
+    unsigned bucket_size(unsigned i) const {
+      unsigned N = 0;
+      for(Chunk* C = Buckets[i]; C != NULL; C = C->Next) { N += C->Count; }
+      return N;
+    } // unsigned bucket_size(unsigned i) const {
+
+    // The bucket that key hashes to
+    unsigned bucket(const K& key) const { return Hash(key); }
+
+    float max_load_factor() const { return Max_Load_Factor; }
+
+    /* Set the max load factor. If the table is already fuller than the new
+    max load factor then it is grown immediately. */
+    void max_load_factor(float New_Max_Load_Factor) {
+      if(New_Max_Load_Factor <= 0) { return; }
+      Max_Load_Factor = New_Max_Load_Factor;
+
+      if(N_Items > Max_Load_Factor*N_Buckets) { rehash((unsigned)(N_Items/Max_Load_Factor) + 1); }
+    } // void max_load_factor(float New_Max_Load_Factor) {
+
+    /* Make room for N items: grow the bucket array so that N items won't
+    exceed the max load factor, and get enough chunks ready in the pool (every
+    new item might need a new chunk in a new bucket, or failing that, a share
+    of a full chunk). */
+    void reserve(unsigned N) {
+      unsigned New_N_Buckets = (unsigned)(N/Max_Load_Factor) + 1;
+      if(New_N_Buckets > N_Buckets) { rehash(New_N_Buckets); }
+
+      if(N > N_Items) {
+        unsigned N_New = N - N_Items;
+        Chunks.reserve(((N_New < N_Buckets) ? N_New : N_Buckets) + N_New/Chunk::Capacity);
+      } // if(N > N_Items) {
+    } // void reserve(unsigned N) {
+
+
+    /* Prefetch what a lookup of key will read (see Chained_Storage). Stage 0
+    prefetches the key's bucket, and stage 1 prefetches the bucket's first
+    chunk. */
+    static const unsigned Prefetch_Stages = 2;
+    void prefetch(const K& key, unsigned Stage) const {
+      Chunk* const& First = Buckets[Hash(key)];
+      if(Stage == 0) { HASH_TABLE_PREFETCH(&First); }
+      else { HASH_TABLE_PREFETCH(First); }
+    } // void prefetch(const K& key, unsigned Stage) const {
+
+
+    /* Move every item into a new array of New_N_Buckets buckets (rounded by
+    the growth policy). Items are moved into new chunks, and each old chunk is
+    freed as soon as it's empty. */
+    void rehash(unsigned New_N_Buckets) {
+      New_N_Buckets = Growth::size(New_N_Buckets);
+
+      Chunk** Old_Buckets = Buckets;
+      unsigned Old_N_Buckets = N_Buckets;
+
+      // Hash uses the policy, so update it before moving items.
+      Buckets = new Chunk*[New_N_Buckets]();
+      N_Buckets = New_N_Buckets;
+      Policy = Growth(N_Buckets);
+
+      for(unsigned b = 0; b < Old_N_Buckets; b++) {
+        Chunk* C = Old_Buckets[b];
+        while(C != NULL) {
+          for(unsigned i = 0; i < C->Count; i++) {
+            Chunk* To = Chunk_With_Room(Hash(C->key(i)));
+            new (&To->Keys[To->Count]) K(std::move(C->key(i)));
+            new (&To->Values[To->Count]) V(std::move(C->value(i)));
+            To->Count++;
+            C->destroy(i);
+          } // for(unsigned i = 0; i < C->Count; i++) {
+
+          Chunk* Next = C->Next;
+          Chunks.deallocate(C);
+          C = Next;
+        } // while(C != NULL) {
+      } // for(unsigned b = 0; b < Old_N_Buckets; b++) {
+
+      delete [] Old_Buckets;
+    } // void rehash(unsigned New_N_Buckets) {
+
+
+    /* If no item has the specified key, add one whose value is constructed
+    (in its chunk) from args. Returns a pointer to the key's value and true if
+    the item is new. If the key was already in the table, args are left alone.
+    key should be a K (or reference to one). */
+    template<typename Key_Arg, typename... Args>
+    std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+      unsigned i;
+      Chunk* C = Find_Item(key, i);
+      if(C != NULL) { return std::pair<V*, bool>(&C->value(i), false); }
+
+      // Grow first, since growing moves items.
+      if(N_Items + 1 > Max_Load_Factor*N_Buckets) { rehash(Growth::grow(N_Buckets)); }
+
+      /* Build the item at the end of the bucket's first chunk. If that throws,
+      we may have to free a chunk we just added. */
+      unsigned b = Hash(key);
+      C = Chunk_With_Room(b);
+      i = C->Count;
+      try { new (&C->Keys[i]) K(std::forward<Key_Arg>(key)); }
+      catch(...) {
+        Free_First_If_Empty(b);
+        throw;
+      } // catch(...) {
+
+      try { new (&C->Values[i]) V(std::forward<Args>(args)...); }
+      catch(...) {
+        C->key(i).~K();
+        Free_First_If_Empty(b);
+        throw;
+      } // catch(...) {
+
+      C->Count++;
+      N_Items++;
+      return std::pair<V*, bool>(&C->value(i), true);
+    } // std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      unsigned i;
+      Chunk* C = Find_Item(key, i);
+      if(C == NULL) { return; }
+
+      Remove_Item(Hash(key), C, i);
+      N_Items--;
+    } // void remove(const K& key) {
+
+
+    /* Find the value of the item with the specified key. Returns NULL if no
+    item has that key. */
+    V* find(const K& key) {
+      unsigned i;
+      Chunk* C = Find_Item(key, i);
+      return (C == NULL) ? NULL : &C->value(i);
+    } // V* find(const K& key) {
+
+    const V* find(const K& key) const {
+      unsigned i;
+      const Chunk* C = Find_Item(key, i);
+      return (C == NULL) ? NULL : &C->value(i);
+    } // const V* find(const K& key) const {
+
+
+    /* Printing method. Items in the same chunk are separated by commas, and
+    chunks by arrows. */
+    friend std::ostream & operator<<(std::ostream & os, const Unrolled_Storage & Table) {
+      unsigned N_Buckets = Table.N_Buckets;
+      for(unsigned b = 0; b < N_Buckets; b++) {
+        os << "Bucket " << b << ": ";
+        for(const Chunk* C = Table.Buckets[b]; C != NULL; C = C->Next) {
+          for(unsigned i = 0; i < C->Count; i++) {
+            if(i != 0) { os << ", "; }
+            os << "{" << C->key(i) << " : " << C->value(i) << "}";
+          } // for(unsigned i = 0; i < C->Count; i++) {
+
+          if(C->Next != NULL) { os << " -> "; }
+        } // for(const Chunk* C = Table.Buckets[b]; C != NULL; C = C->Next) {
+        os << std::endl;
+      } // for(unsigned b = 0; b < N_Buckets; b++) {
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Unrolled_Storage & Table) {
+}; // class Unrolled_Storage {
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Open addressing
+
+/* A slot in an open addressing table. The item is stored inline, right next to
+the flag that says whether the slot is in use, so checking a slot touches a
+single cache line. The item's storage is left uninitialized until an item is
+placed in the slot (so empty slots never construct a K or V). */
+template<typename K, typename V>
+struct Probe_Slot {
+  typename std::aligned_storage<sizeof(Item<K, V>), alignof(Item<K, V>)>::type Storage;
+  bool Occupied;
+
+  Item<K, V>* item() { return reinterpret_cast<Item<K, V>*>(&Storage); }
+  const Item<K, V>* item() const { return reinterpret_cast<const Item<K, V>*>(&Storage); }
+}; // struct Probe_Slot {
+
+
+
+/* Linear probing storage engine. Every item lives directly in one flat array
+of slots. An item is stored in the first free slot at or after its home slot
+(wrapping around at the end of the array), so a lookup scans forward from the
+home slot until it either finds the key or hits an empty slot. Inserts never
+allocate (unless the table grows).
+
+Removals use backward shift deletion: rather than leaving a tombstone, we move
+later items in the same probe run back to fill the hole. This keeps every
+probe run contiguous, so lookups never have to skip over deleted slots. */
+template <typename K, typename V, typename KeyHash, typename KeyEqual, typename Growth>
+class Linear_Probe_Storage {
+  private:
+    unsigned N_Slots;
+    Probe_Slot<K, V>* Slots;
+    Growth Policy;                         // Maps hashes to slot indices
+
+    KeyHash Hasher;
+    KeyEqual Key_Equal;
+
+    unsigned N_Items;                      // Number of items in the table
+    float Max_Load_Factor;                 // Largest allowed N_Items/N_Slots
+
+    // Hashing function
+    unsigned Hash(const K& key) const { return Policy.index(Hasher(key)); }
+
+    // Index of the slot after slot i (wrapping around at the end).
+    unsigned Next_Slot(unsigned i) const { return (i + 1 == N_Slots) ? 0 : i + 1; }
+
+    // Number of steps to get from slot i to slot j (moving forward).
+    unsigned Distance(unsigned i, unsigned j) const { return (j >= i) ? j - i : j + N_Slots - i; }
+
+
+    /* Returns the index of the slot holding the item with the specified key,
+    or N_Slots if there is no such item. */
+    unsigned Find_Slot(const K& key) const {
+      unsigned i = Hash(key);
+
+      /* The table always has at least one empty slot (since the max load
+      factor is less than 1), so this loop will terminate. */
+      while(Slots[i].Occupied == true) {
+        if(Key_Equal(Slots[i].item()->key, key) == true) { return i; }
+        i = Next_Slot(i);
+      } // while(Slots[i].Occupied == true) {
+
+      return N_Slots;
+    } // unsigned Find_Slot(const K& key) const {
+
+
+    /* Move the item in slot From into the empty slot To. Afterwards, From is
+    empty. */
+    void Move_Slot(unsigned From, unsigned To) {
+      new (Slots[To].item()) Item<K, V>(std::move(*Slots[From].item()));
+      Slots[To].Occupied = true;
+
+      Slots[From].item()->~Item<K, V>();
+      Slots[From].Occupied = false;
+    } // void Move_Slot(unsigned From, unsigned To) {
+
+
+    /* If inserting one more item would push the load factor past the max load
+    factor, then grow the table (by however much the growth policy says). */
+    void Grow_If_Needed() {
+      if(N_Items + 1 > Max_Load_Factor*N_Slots) { rehash(Growth::grow(N_Slots)); }
+    } // void Grow_If_Needed() {
+
+    // Delete the implicit = operator and copy constructor methods
+    Linear_Probe_Storage(const Linear_Probe_Storage &) = delete;
+    Linear_Probe_Storage& operator=(const Linear_Probe_Storage &) = delete;
+
+  public:
+    // Constructor, destructor
+    Linear_Probe_Storage(unsigned N_Slots = 11, float Max_Load_Factor = 0.7,
+                         const KeyHash& Hasher = KeyHash(), const KeyEqual& Key_Equal = KeyEqual())
+        : Hasher(Hasher), Key_Equal(Key_Equal), N_Items(0) {
+      // The growth policy decides the actual number of slots.
+      N_Slots = Growth::size(N_Slots);
+
+      /* Linear probing needs at least one empty slot (otherwise a search for a
+      missing key would never stop), and gets slow as the table fills up, so
+      the max load factor must be in (0, 1). */
+      if(Max_Load_Factor <= 0 || Max_Load_Factor >= 1) { Max_Load_Factor = 0.7; }
+
+      Linear_Probe_Storage::N_Slots = N_Slots;
+      Linear_Probe_Storage::Max_Load_Factor = Max_Load_Factor;
+
+      // Value-initialize the slots so that they all start out unoccupied.
+      Slots = new Probe_Slot<K, V>[N_Slots]();
+      Policy = Growth(N_Slots);
+    } // Linear_Probe_Storage(unsigned N_Slots = 11, float Max_Load_Factor = 0.7) {
+
+    ~Linear_Probe_Storage() {
+      for(unsigned i = 0; i < N_Slots; i++) {
+        if(Slots[i].Occupied == true) { Slots[i].item()->~Item<K, V>(); }
+      } // for(unsigned i = 0; i < N_Slots; i++) {
+
+      delete [] Slots;
+    } // ~Linear_Probe_Storage() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned size() const { return N_Items; }
+    unsigned bucket_count() const { return N_Slots; }
+    float load_factor() const { return ((float)N_Items)/N_Slots; }
+    float max_load_factor() const { return Max_Load_Factor; }
+
+    // The home slot of key
+    unsigned bucket(const K& key) const { return Hash(key); }
+
+    /* Prefetch what a lookup of key will read (see Chained_Storage). Probing
+    starts at the key's home slot, so that's all we need. */
+    static const unsigned Prefetch_Stages = 1;
+    void prefetch(const K& key, unsigned) const { HASH_TABLE_PREFETCH(&Slots[Hash(key)]); }
+
+    /* Make room for N items (so that inserting until there are N items won't
+    rehash). */
+    void reserve(unsigned N) {
+      unsigned New_N_Slots = (unsigned)(N/Max_Load_Factor) + 1;
+      if(New_N_Slots > N_Slots) { rehash(New_N_Slots); }
+    } // void reserve(unsigned N) {
+
+    /* Set the max load factor. If the table is already fuller than the new
+    max load factor then it is grown immediately. */
+    void max_load_factor(float New_Max_Load_Factor) {
+      if(New_Max_Load_Factor <= 0 || New_Max_Load_Factor >= 1) { return; }
+      Max_Load_Factor = New_Max_Load_Factor;
+
+      if(N_Items > Max_Load_Factor*N_Slots) { rehash(N_Slots); }
+    } // void max_load_factor(float New_Max_Load_Factor) {
+
+
+    /* Move every item into a new array of (at least) New_N_Slots slots. If
+    New_N_Slots is too small to hold the current items without exceeding the
+    max load factor, we use more slots. */
+    void rehash(unsigned New_N_Slots) {
+      New_N_Slots = Growth::size(New_N_Slots);
+      while(N_Items + 1 > Max_Load_Factor*New_N_Slots) {
+        New_N_Slots = Growth::size(Growth::grow(New_N_Slots));
+      } // while(N_Items + 1 > Max_Load_Factor*New_N_Slots) {
+
+      Probe_Slot<K, V>* Old_Slots = Slots;
+      unsigned Old_N_Slots = N_Slots;
+
+      // Hash uses the policy, so update it before moving items.
+      Slots = new Probe_Slot<K, V>[New_N_Slots]();
+      N_Slots = New_N_Slots;
+      Policy = Growth(N_Slots);
+
+      for(unsigned i = 0; i < Old_N_Slots; i++) {
+        if(Old_Slots[i].Occupied == false) { continue; }
+
+        // Keys are unique, so we just need to find the first free slot.
+        unsigned j = Hash(Old_Slots[i].item()->key);
+        while(Slots[j].Occupied == true) { j = Next_Slot(j); }
+
+        new (Slots[j].item()) Item<K, V>(std::move(*Old_Slots[i].item()));
+        Slots[j].Occupied = true;
+        Old_Slots[i].item()->~Item<K, V>();
+      } // for(unsigned i = 0; i < Old_N_Slots; i++) {
+
+      delete [] Old_Slots;
+    } // void rehash(unsigned New_N_Slots) {
+
+
+    /* If no item has the specified key, add one whose value is constructed
+    (in its slot) from args. Returns a pointer to the key's value and true if
+    the item is new. If the key was already in the table, args are left alone.
+    key should be a K (or reference to one). */
+    template<typename Key_Arg, typename... Args>
+    std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+      // If the key is already in the table, we're done.
+      unsigned i = Find_Slot(key);
+      if(i != N_Slots) { return std::pair<V*, bool>(&Slots[i].item()->value, false); }
+
+      /* Otherwise, we need to add a new item. Make sure there's room first
+      (growing changes where the item goes), then build the new item in the
+      first free slot at or after its home slot. */
+      Grow_If_Needed();
+
+      i = Hash(key);
+      while(Slots[i].Occupied == true) { i = Next_Slot(i); }
+
+      new (Slots[i].item()) Item<K, V>(std::forward<Key_Arg>(key), std::forward<Args>(args)...);
+      Slots[i].Occupied = true;
+      N_Items++;
+      return std::pair<V*, bool>(&Slots[i].item()->value, true);
+    } // std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      unsigned i = Find_Slot(key);
+      if(i == N_Slots) { return; }
+
+      Slots[i].item()->~Item<K, V>();
+      Slots[i].Occupied = false;
+      N_Items--;
+
+      /* Now, slot i is a hole. Walk forward through the rest of the probe run.
+      If an item's home slot is at or before the hole (i.e. the item probed
+      past the hole to get to where it is) then we move it back into the hole,
+      which leaves a new hole where that item was. We stop at the first empty
+      slot, since that is the end of the run. */
+      unsigned j = Next_Slot(i);
+      while(Slots[j].Occupied == true) {
+        unsigned Home = Hash(Slots[j].item()->key);
+        if(Distance(Home, j) >= Distance(i, j)) {
+          Move_Slot(j, i);
+          i = j;
+        } // if(Distance(Home, j) >= Distance(i, j)) {
+
+        j = Next_Slot(j);
+      } // while(Slots[j].Occupied == true) {
+    } // void remove(const K& key) {
+
+
+    /* Find the value of the item with the specified key. Returns NULL if no
+    item has that key. */
+    V* find(const K& key) {
+      unsigned i = Find_Slot(key);
+      return (i == N_Slots) ? NULL : &Slots[i].item()->value;
+    } // V* find(const K& key) {
+
+    const V* find(const K& key) const {
+      unsigned i = Find_Slot(key);
+      return (i == N_Slots) ? NULL : &Slots[i].item()->value;
+    } // const V* find(const K& key) const {
+
+
+    // Printing method
+    friend std::ostream & operator<<(std::ostream & os, const Linear_Probe_Storage & Table) {
+      unsigned N_Slots = Table.N_Slots;
+      for(unsigned i = 0; i < N_Slots; i++) {
+        os << "Slot " << i << ": ";
+        if(Table.Slots[i].Occupied == true) {
+          os << "{" << Table.Slots[i].item()->key << " : " << Table.Slots[i].item()->value << "}";
+        } // if(Table.Slots[i].Occupied == true) {
+        os << std::endl;
+      } // for(unsigned i = 0; i < N_Slots; i++) {
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Linear_Probe_Storage & Table) {
+}; // class Linear_Probe_Storage {
+
+
+
+
+
+/* A slot in a Robin Hood table. Probe_Length is the number of slots that a
+lookup for this slot's item probes to reach it (so an item in its home slot has
+a probe length of 1). An empty slot has a probe length of 0. */
+template<typename K, typename V>
+struct Robin_Hood_Slot {
+  typename std::aligned_storage<sizeof(Item<K, V>), alignof(Item<K, V>)>::type Storage;
+  unsigned Probe_Length;
+
+  Item<K, V>* item() { return reinterpret_cast<Item<K, V>*>(&Storage); }
+  const Item<K, V>* item() const { return reinterpret_cast<const Item<K, V>*>(&Storage); }
+}; // struct Robin_Hood_Slot {
+
+
+
+/* Robin Hood storage engine. This is linear probing, except that on insert,
+the item being inserted takes the slot of any item that is closer to its home
+slot ("richer") than the new item is, and that item continues probing instead.
+This evens out probe lengths, so they stay short (and have low variance) even
+at high load factors.
+
+It also means that, along any probe run, items are ordered by how far they
+are from home. So a lookup can stop as soon as it reaches a slot whose item is
+closer to home than the key would be at that point; if the key were in the
+table, it would have taken that slot. This makes misses cheap.
+
+Removals use backward shift deletion (like Linear_Probe_Storage). */
+template <typename K, typename V, typename KeyHash, typename KeyEqual, typename Growth>
+class Robin_Hood_Storage {
+  private:
+    unsigned N_Slots;
+    Robin_Hood_Slot<K, V>* Slots;
+    Growth Policy;                         // Maps hashes to slot indices
+
+    KeyHash Hasher;
+    KeyEqual Key_Equal;
+
+    unsigned N_Items;                      // Number of items in the table
+    float Max_Load_Factor;                 // Largest allowed N_Items/N_Slots
+
+    // Hashing function
+    unsigned Hash(const K& key) const { return Policy.index(Hasher(key)); }
+
+    // Index of the slot after slot i (wrapping around at the end).
+    unsigned Next_Slot(unsigned i) const { return (i + 1 == N_Slots) ? 0 : i + 1; }
+
+
+    /* Probe for key. If the key is in the table, this returns true and sets i
+    to its slot. Otherwise, this returns false, and i and Probe_Length are
+    where the key would go: the first slot that is either empty or holds an
+    item that is closer to home than the key would be. */
+    bool Probe(const K& key, unsigned& i, unsigned& Probe_Length) const {
+      i = Hash(key);
+      Probe_Length = 1;
+
+      // Empty slots have a probe length of 0, so this also stops at them.
+      while(Slots[i].Probe_Length >= Probe_Length) {
+        if(Slots[i].Probe_Length == Probe_Length && Key_Equal(Slots[i].item()->key, key) == true) { return true; }
+
+        i = Next_Slot(i);
+        Probe_Length++;
+      } // while(Slots[i].Probe_Length >= Probe_Length) {
+
+      return false;
+    } // bool Probe(const K& key, unsigned& i, unsigned& Probe_Length) const {
+
+
+    /* Put Carried (whose key is not in the table) in the table, starting at
+    slot i with probe length Probe_Length. Whenever we reach an item that is
+    closer to home than the carried item, the two trade places, and we carry
+    on with the item we just displaced. */
+    void Place(Item<K, V>& Carried, unsigned i, unsigned Probe_Length) {
+      while(Slots[i].Probe_Length != 0) {
+        if(Slots[i].Probe_Length < Probe_Length) {
+          std::swap(Carried, *Slots[i].item());
+          std::swap(Probe_Length, Slots[i].Probe_Length);
+        } // if(Slots[i].Probe_Length < Probe_Length) {
+
+        i = Next_Slot(i);
+        Probe_Length++;
+      } // while(Slots[i].Probe_Length != 0) {
+
+      new (Slots[i].item()) Item<K, V>(std::move(Carried));
+      Slots[i].Probe_Length = Probe_Length;
+    } // void Place(Item<K, V>& Carried, unsigned i, unsigned Probe_Length) {
+
+
+    // Delete the implicit = operator and copy constructor methods
+    Robin_Hood_Storage(const Robin_Hood_Storage &) = delete;
+    Robin_Hood_Storage& operator=(const Robin_Hood_Storage &) = delete;
+
+  public:
+    // Constructor, destructor
+    Robin_Hood_Storage(unsigned N_Slots = 11, float Max_Load_Factor = 0.9,
+                       const KeyHash& Hasher = KeyHash(), const KeyEqual& Key_Equal = KeyEqual())
+        : Hasher(Hasher), Key_Equal(Key_Equal), N_Items(0) {
+      // The growth policy decides the actual number of slots.
+      N_Slots = Growth::size(N_Slots);
+
+      // We need at least one empty slot, so the max load factor must be in (0, 1).
+      if(Max_Load_Factor <= 0 || Max_Load_Factor >= 1) { Max_Load_Factor = 0.9; }
+
+      Robin_Hood_Storage::N_Slots = N_Slots;
+      Robin_Hood_Storage::Max_Load_Factor = Max_Load_Factor;
+
+      // Value-initialize the slots so that they all start out empty.
+      Slots = new Robin_Hood_Slot<K, V>[N_Slots]();
+      Policy = Growth(N_Slots);
+    } // Robin_Hood_Storage(unsigned N_Slots = 11, float Max_Load_Factor = 0.9) {
+
+    ~Robin_Hood_Storage() {
+      for(unsigned i = 0; i < N_Slots; i++) {
+        if(Slots[i].Probe_Length != 0) { Slots[i].item()->~Item<K, V>(); }
+      } // for(unsigned i = 0; i < N_Slots; i++) {
+
+      delete [] Slots;
+    } // ~Robin_Hood_Storage() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned size() const { return N_Items; }
+    unsigned bucket_count() const { return N_Slots; }
+    float load_factor() const { return ((float)N_Items)/N_Slots; }
+    float max_load_factor() const { return Max_Load_Factor; }
+
+    // The home slot of key
+    unsigned bucket(const K& key) const { return Hash(key); }
+
+    /* Prefetch what a lookup of key will read (see Chained_Storage). Probing
+    starts at the key's home slot, so that's all we need. */
+    static const unsigned Prefetch_Stages = 1;
+    void prefetch(const K& key, unsigned) const { HASH_TABLE_PREFETCH(&Slots[Hash(key)]); }
+
+    /* Make room for N items (so that inserting until there are N items won't
+    rehash). */
+    void reserve(unsigned N) {
+      unsigned New_N_Slots = (unsigned)(N/Max_Load_Factor) + 1;
+      if(New_N_Slots > N_Slots) { rehash(New_N_Slots); }
+    } // void reserve(unsigned N) {
+
+    /* Set the max load factor. If the table is already fuller than the new
+    max load factor then it is grown immediately. */
+    void max_load_factor(float New_Max_Load_Factor) {
+      if(New_Max_Load_Factor <= 0 || New_Max_Load_Factor >= 1) { return; }
+      Max_Load_Factor = New_Max_Load_Factor;
+
+      if(N_Items > Max_Load_Factor*N_Slots) { rehash(N_Slots); }
+    } // void max_load_factor(float New_Max_Load_Factor) {
+
+    // Longest probe length of any item in the table (i.e. the worst case hit).
+    unsigned max_probe_length() const {
+      unsigned Longest = 0;
+      for(unsigned i = 0; i < N_Slots; i++) {
+        if(Slots[i].Probe_Length > Longest) { Longest = Slots[i].Probe_Length; }
+      } // for(unsigned i = 0; i < N_Slots; i++) {
+      return Longest;
+    } // unsigned max_probe_length() const {
+
+
+    /* Move every item into a new array of (at least) New_N_Slots slots. If
+    New_N_Slots is too small to hold the current items without exceeding the
+    max load factor, we use more slots. */
+    void rehash(unsigned New_N_Slots) {
+      New_N_Slots = Growth::size(New_N_Slots);
+      while(N_Items + 1 > Max_Load_Factor*New_N_Slots) {
+        New_N_Slots = Growth::size(Growth::grow(New_N_Slots));
+      } // while(N_Items + 1 > Max_Load_Factor*New_N_Slots) {
+
+      Robin_Hood_Slot<K, V>* Old_Slots = Slots;
+      unsigned Old_N_Slots = N_Slots;
+
+      // Hash uses the policy, so update it before moving items.
+      Slots = new Robin_Hood_Slot<K, V>[New_N_Slots]();
+      N_Slots = New_N_Slots;
+      Policy = Growth(N_Slots);
+
+      for(unsigned i = 0; i < Old_N_Slots; i++) {
+        if(Old_Slots[i].Probe_Length == 0) { continue; }
+
+        Item<K, V> Carried(std::move(*Old_Slots[i].item()));
+        Old_Slots[i].item()->~Item<K, V>();
+        Place(Carried, Hash(Carried.key), 1);
+      } // for(unsigned i = 0; i < Old_N_Slots; i++) {
+
+      delete [] Old_Slots;
+    } // void rehash(unsigned New_N_Slots) {
+
+
+    /* If no item has the specified key, add one whose value is constructed
+    (in its slot) from args. Returns a pointer to the key's value and true if
+    the item is new. If the key was already in the table, args are left alone.
+    key should be a K (or reference to one). */
+    template<typename Key_Arg, typename... Args>
+    std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+      // If the key is already in the table, we're done.
+      unsigned i, Probe_Length;
+      if(Probe(key, i, Probe_Length) == true) { return std::pair<V*, bool>(&Slots[i].item()->value, false); }
+
+      /* Otherwise, we need to add a new item. If the table needs to grow then
+      the item's position changes, so we have to probe again. */
+      if(N_Items + 1 > Max_Load_Factor*N_Slots) {
+        rehash(Growth::grow(N_Slots));
+        Probe(key, i, Probe_Length);
+      } // if(N_Items + 1 > Max_Load_Factor*N_Slots) {
+
+      /* The new item belongs in slot i. If that slot is taken, move its item
+      out (and put it back if building the new item throws). Once the new item
+      is in place, the displaced item carries on down the probe run. */
+      if(Slots[i].Probe_Length == 0) {
+        new (Slots[i].item()) Item<K, V>(std::forward<Key_Arg>(key), std::forward<Args>(args)...);
+        Slots[i].Probe_Length = Probe_Length;
+      } // if(Slots[i].Probe_Length == 0) {
+      else {
+        Item<K, V> Displaced(std::move(*Slots[i].item()));
+        unsigned Displaced_Probe_Length = Slots[i].Probe_Length;
+        Slots[i].item()->~Item<K, V>();
+
+        try { new (Slots[i].item()) Item<K, V>(std::forward<Key_Arg>(key), std::forward<Args>(args)...); }
+        catch(...) {
+          new (Slots[i].item()) Item<K, V>(std::move(Displaced));
+          throw;
+        } // catch(...) {
+        Slots[i].Probe_Length = Probe_Length;
+
+        Place(Displaced, Next_Slot(i), Displaced_Probe_Length + 1);
+      } // else
+
+      N_Items++;
+      return std::pair<V*, bool>(&Slots[i].item()->value, true);
+    } // std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      unsigned i, Probe_Length;
+      if(Probe(key, i, Probe_Length) == false) { return; }
+
+      Slots[i].item()->~Item<K, V>();
+      Slots[i].Probe_Length = 0;
+      N_Items--;
+
+      /* Shift the rest of the probe run back by one slot, until we reach an
+      empty slot or an item that is already in its home slot. Each item we
+      move gets one step closer to home. */
+      unsigned j = Next_Slot(i);
+      while(Slots[j].Probe_Length > 1) {
+        new (Slots[i].item()) Item<K, V>(std::move(*Slots[j].item()));
+        Slots[i].Probe_Length = Slots[j].Probe_Length - 1;
+
+        Slots[j].item()->~Item<K, V>();
+        Slots[j].Probe_Length = 0;
+
+        i = j;
+        j = Next_Slot(j);
+      } // while(Slots[j].Probe_Length > 1) {
+    } // void remove(const K& key) {
+
+
+    /* Find the value of the item with the specified key. Returns NULL if no
+    item has that key. */
+    V* find(const K& key) {
+      unsigned i, Probe_Length;
+      return (Probe(key, i, Probe_Length) == true) ? &Slots[i].item()->value : NULL;
+    } // V* find(const K& key) {
+
+    const V* find(const K& key) const {
+      unsigned i, Probe_Length;
+      return (Probe(key, i, Probe_Length) == true) ? &Slots[i].item()->value : NULL;
+    } // const V* find(const K& key) const {
+
+
+    // Printing method
+    friend std::ostream & operator<<(std::ostream & os, const Robin_Hood_Storage & Table) {
+      unsigned N_Slots = Table.N_Slots;
+      for(unsigned i = 0; i < N_Slots; i++) {
+        os << "Slot " << i << ": ";
+        if(Table.Slots[i].Probe_Length != 0) {
+          os << "{" << Table.Slots[i].item()->key << " : " << Table.Slots[i].item()->value << "}";
+        } // if(Table.Slots[i].Probe_Length != 0) {
+        os << std::endl;
+      } // for(unsigned i = 0; i < N_Slots; i++) {
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Robin_Hood_Storage & Table) {
+}; // class Robin_Hood_Storage {
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline chains
+
+/* A bucket whose first item is stored inline (in First, see Probe_Slot).
+Any other items in the bucket are in a linked list of nodes (Overflow). If
+First is empty then so is Overflow. */
+template<typename K, typename V>
+struct Inline_Bucket {
+  Probe_Slot<K, V> First;
+  Item_Node<K, V>* Overflow;
+}; // struct Inline_Bucket {
+
+
+
+/* Inline chained storage engine. This is chaining, but each bucket holds its
+first item itself, so a lookup for a key that's alone in its bucket (or first
+in it) reads one bucket and nothing else. Only the other items (about a third
+of them at a load factor of 1) go in overflow nodes, which come from a
+Node_Pool.
+
+When the inline item is removed, the first overflow item moves into the
+bucket. Items also move when the table is rehashed, so pointers to values are
+only good until the table next changes. */
+template <typename K, typename V, typename KeyHash, typename KeyEqual, typename Growth>
+class Inline_Chained_Storage {
+  private:
+    typedef Inline_Bucket<K, V> Bucket;
+
+    unsigned N_Buckets;
+    Bucket* Buckets;
+    Growth Policy;                         // Maps hashes to bucket indices
+    Node_Pool<K, V> Nodes;                 // Where every overflow node comes from
+
+    KeyHash Hasher;
+    KeyEqual Key_Equal;
+
+    unsigned N_Items;                      // Number of items in the table
+    float Max_Load_Factor;                 // Largest allowed N_Items/N_Buckets
+
+    // Hashing function
+    unsigned Hash(const K& key) const { return Policy.index(Hasher(key)); }
+
+
+    // Pointer to the value of the item with the specified key (or NULL).
+    V* Find_Value(const K& key) const {
+      Bucket& Key_Bucket = Buckets[Hash(key)];
+      if(Key_Bucket.First.Occupied == false) { return NULL; }
+      if(Key_Equal(Key_Bucket.First.item()->key, key) == true) { return &Key_Bucket.First.item()->value; }
+
+      for(Item_Node<K, V>* Node = Key_Bucket.Overflow; Node != NULL; Node = Node->getNext()) {
+        if(Key_Equal(Node->getKey(), key) == true) { return &Node->getValue(); }
+      } // for(Item_Node<K, V>* Node = Key_Bucket.Overflow; Node != NULL; Node = Node->getNext()) {
+
+      return NULL;
+    } // V* Find_Value(const K& key) const {
+
+
+    // Put a node (from the old bucket array) into its bucket, while rehashing.
+    void Place_Node(Item_Node<K, V>* Node) {
+      Bucket& To = Buckets[Hash(Node->getKey())];
+      if(To.First.Occupied == false) {
+        new (To.First.item()) Item<K, V>(std::move(Node->getItem()));
+        To.First.Occupied = true;
+        Nodes.deallocate(Node);
+      } // if(To.First.Occupied == false) {
+      else {
+        Node->setNext(To.Overflow);
+        To.Overflow = Node;
+      } // else
+    } // void Place_Node(Item_Node<K, V>* Node) {
+
+
+    // Put an item (from the old bucket array) into its bucket, while rehashing.
+    void Place_Item(Item<K, V>& Moving) {
+      Bucket& To = Buckets[Hash(Moving.key)];
+      if(To.First.Occupied == false) {
+        new (To.First.item()) Item<K, V>(std::move(Moving));
+        To.First.Occupied = true;
+      } // if(To.First.Occupied == false) {
+      else {
+        Item_Node<K, V>* Node = Nodes.allocate(std::move(Moving.key), std::move(Moving.value));
+        Node->setNext(To.Overflow);
+        To.Overflow = Node;
+      } // else
+    } // void Place_Item(Item<K, V>& Moving) {
+
+    // Delete the implicit = operator and copy constructor methods
+    Inline_Chained_Storage(const Inline_Chained_Storage &) = delete;
+    Inline_Chained_Storage& operator=(const Inline_Chained_Storage &) = delete;
+
+  public:
+    // Constructor, destructor
+    Inline_Chained_Storage(unsigned N_Buckets = 11, float Max_Load_Factor = 1.0,
+                           const KeyHash& Hasher = KeyHash(), const KeyEqual& Key_Equal = KeyEqual())
+        : Hasher(Hasher), Key_Equal(Key_Equal), N_Items(0) {
+      // The growth policy decides the actual number of buckets.
+      N_Buckets = Growth::size(N_Buckets);
+
+      // A non-positive load factor makes no sense, so use the default.
+      if(Max_Load_Factor <= 0) { Max_Load_Factor = 1.0; }
+
+      Inline_Chained_Storage::N_Buckets = N_Buckets;
+      Inline_Chained_Storage::Max_Load_Factor = Max_Load_Factor;
+
+      // Value-initialize the buckets so that they all start out empty.
+      Buckets = new Bucket[N_Buckets]();
+      Policy = Growth(N_Buckets);
+    } // Inline_Chained_Storage(unsigned N_Buckets = 11, float Max_Load_Factor = 1.0) {
+
+    ~Inline_Chained_Storage() {
+      // The pool frees the nodes' memory, so we just need to destroy the items.
+      for(unsigned i = 0; i < N_Buckets; i++) {
+        if(Buckets[i].First.Occupied == false) { continue; }
+        Buckets[i].First.item()->~Item<K, V>();
+
+        if(std::is_trivially_destructible< Item_Node<K, V> >::value == true) { continue; }
+        Item_Node<K, V>* Node = Buckets[i].Overflow;
+        while(Node != NULL) {
+          Item_Node<K, V>* Next = Node->getNext();
+          Nodes.deallocate(Node);
+          Node = Next;
+        } // while(Node != NULL) {
+      } // for(unsigned i = 0; i < N_Buckets; i++) {
+
+      delete [] Buckets;
+    } // ~Inline_Chained_Storage() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned size() const { return N_Items; }
+    unsigned bucket_count() const { return N_Buckets; }
+    float load_factor() const { return ((float)N_Items)/N_Buckets; }
+
+    // Number of items in the i'th bucket
+    unsigned bucket_size(unsigned i) const {
+      if(Buckets[i].First.Occupied == false) { return 0; }
+
+      unsigned N = 1;
+      for(Item_Node<K, V>* Node = Buckets[i].Overflow; Node != NULL; Node = Node->getNext()) { N++; }
+      return N;
+    } // unsigned bucket_size(unsigned i) const {
+
+    // The bucket that key hashes to
+    unsigned bucket(const K& key) const { return Hash(key); }
+
+    float max_load_factor() const { return Max_Load_Factor; }
+
+    /* Set the max load factor. If the table is already fuller than the new
+    max load factor then it is grown immediately. */
+    void max_load_factor(float New_Max_Load_Factor) {
+      if(New_Max_Load_Factor <= 0) { return; }
+      Max_Load_Factor = New_Max_Load_Factor;
+
+      if(N_Items > Max_Load_Factor*N_Buckets) { rehash((unsigned)(N_Items/Max_Load_Factor) + 1); }
+    } // void max_load_factor(float New_Max_Load_Factor) {
+
+    /* Make room for N items (so that inserting until there are N items won't
+    rehash). Overflow nodes are still allocated as they're needed. */
+    void reserve(unsigned N) {
+      unsigned New_N_Buckets = (unsigned)(N/Max_Load_Factor) + 1;
+      if(New_N_Buckets > N_Buckets) { rehash(New_N_Buckets); }
+    } // void reserve(unsigned N) {
+
+
+    /* Prefetch what a lookup of key will read (see Chained_Storage). Stage 0
+    prefetches the key's bucket. Stage 1 prefetches the first overflow node,
+    but only if the key isn't the inline item. */
+    static const unsigned Prefetch_Stages = 2;
+    void prefetch(const K& key, unsigned Stage) const {
+      const Bucket& Key_Bucket = Buckets[Hash(key)];
+      if(Stage == 0) {
+        HASH_TABLE_PREFETCH(&Key_Bucket);
+        return;
+      } // if(Stage == 0) {
+
+      if(Key_Bucket.Overflow != NULL && Key_Equal(Key_Bucket.First.item()->key, key) == false) {
+        HASH_TABLE_PREFETCH(Key_Bucket.Overflow);
+      } // if(Key_Bucket.Overflow != NULL && Key_Equal(Key_Bucket.First.item()->key, key) == false) {
+    } // void prefetch(const K& key, unsigned Stage) const {
+
+
+    /* Move every item into a new array of New_N_Buckets buckets (rounded by
+    the growth policy). Overflow nodes are relinked (or, if they end up first
+    in their new bucket, moved inline and freed), and inline items are moved
+    (into a new node, if their new bucket already has an inline item). */
+    void rehash(unsigned New_N_Buckets) {
+      New_N_Buckets = Growth::size(New_N_Buckets);
+
+      Bucket* Old_Buckets = Buckets;
+      unsigned Old_N_Buckets = N_Buckets;
+
+      // Hash uses the policy, so update it before moving items.
+      Buckets = new Bucket[New_N_Buckets]();
+      N_Buckets = New_N_Buckets;
+      Policy = Growth(N_Buckets);
+
+      for(unsigned i = 0; i < Old_N_Buckets; i++) {
+        if(Old_Buckets[i].First.Occupied == false) { continue; }
+
+        Place_Item(*Old_Buckets[i].First.item());
+        Old_Buckets[i].First.item()->~Item<K, V>();
+
+        // Placing a node changes its Next, so get that first.
+        Item_Node<K, V>* Node = Old_Buckets[i].Overflow;
+        while(Node != NULL) {
+          Item_Node<K, V>* Next = Node->getNext();
+          Place_Node(Node);
+          Node = Next;
+        } // while(Node != NULL) {
+      } // for(unsigned i = 0; i < Old_N_Buckets; i++) {
+
+      delete [] Old_Buckets;
+    } // void rehash(unsigned New_N_Buckets) {
+
+
+    /* If no item has the specified key, add one whose value is constructed
+    (inline, or in an overflow node) from args. Returns a pointer to the key's
+    value and true if the item is new. If the key was already in the table,
+    args are left alone. key should be a K (or reference to one). */
+    template<typename Key_Arg, typename... Args>
+    std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+      V* Value = Find_Value(key);
+      if(Value != NULL) { return std::pair<V*, bool>(Value, false); }
+
+      // Grow first, since growing moves items.
+      if(N_Items + 1 > Max_Load_Factor*N_Buckets) { rehash(Growth::grow(N_Buckets)); }
+
+      Bucket& Key_Bucket = Buckets[Hash(key)];
+      if(Key_Bucket.First.Occupied == false) {
+        new (Key_Bucket.First.item()) Item<K, V>(std::forward<Key_Arg>(key), std::forward<Args>(args)...);
+        Key_Bucket.First.Occupied = true;
+        Value = &Key_Bucket.First.item()->value;
+      } // if(Key_Bucket.First.Occupied == false) {
+      else {
+        Item_Node<K, V>* Node = Nodes.allocate(std::forward<Key_Arg>(key), std::forward<Args>(args)...);
+        Node->setNext(Key_Bucket.Overflow);
+        Key_Bucket.Overflow = Node;
+        Value = &Node->getValue();
+      } // else
+
+      N_Items++;
+      return std::pair<V*, bool>(Value, true);
+    } // std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      Bucket& Key_Bucket = Buckets[Hash(key)];
+      if(Key_Bucket.First.Occupied == false) { return; }
+
+      /* If the inline item is the one we're removing, then the first overflow
+      item (if there is one) takes its place. */
+      if(Key_Equal(Key_Bucket.First.item()->key, key) == true) {
+        Key_Bucket.First.item()->~Item<K, V>();
+
+        Item_Node<K, V>* Node = Key_Bucket.Overflow;
+        if(Node == NULL) { Key_Bucket.First.Occupied = false; }
+        else {
+          new (Key_Bucket.First.item()) Item<K, V>(std::move(Node->getItem()));
+          Key_Bucket.Overflow = Node->getNext();
+          Nodes.deallocate(Node);
+        } // else
+
+        N_Items--;
+        return;
+      } // if(Key_Equal(Key_Bucket.First.item()->key, key) == true) {
+
+      // Otherwise, look for it in the overflow list.
+      Item_Node<K, V>* Previous = NULL;
+      for(Item_Node<K, V>* Node = Key_Bucket.Overflow; Node != NULL; Node = Node->getNext()) {
+        if(Key_Equal(Node->getKey(), key) == true) {
+          if(Previous == NULL) { Key_Bucket.Overflow = Node->getNext(); }
+          else { Previous->setNext(Node->getNext()); }
+
+          Nodes.deallocate(Node);
+          N_Items--;
+          return;
+        } // if(Key_Equal(Node->getKey(), key) == true) {
+
+        Previous = Node;
+      } // for(Item_Node<K, V>* Node = Key_Bucket.Overflow; Node != NULL; Node = Node->getNext()) {
+    } // void remove(const K& key) {
+
+
+    /* Find the value of the item with the specified key. Returns NULL if no
+    item has that key. */
+    V* find(const K& key) { return Find_Value(key); }
+    const V* find(const K& key) const { return Find_Value(key); }
+
+
+    // Printing method
+    friend std::ostream & operator<<(std::ostream & os, const Inline_Chained_Storage & Table) {
+      unsigned N_Buckets = Table.N_Buckets;
+      for(unsigned i = 0; i < N_Buckets; i++) {
+        os << "Bucket " << i << ": ";
+        if(Table.Buckets[i].First.Occupied == true) {
+          const Item<K, V>& First = *Table.Buckets[i].First.item();
+          os << "{" << First.key << " : " << First.value << "}";
+
+          for(Item_Node<K, V>* Node = Table.Buckets[i].Overflow; Node != NULL; Node = Node->getNext()) {
+            os << " -> {" << Node->getKey() << " : " << Node->getValue() << "}";
+          } // for(Item_Node<K, V>* Node = Table.Buckets[i].Overflow; Node != NULL; Node = Node->getNext()) {
+        } // if(Table.Buckets[i].First.Occupied == true) {
+        os << std::endl;
+      } // for(unsigned i = 0; i < N_Buckets; i++) {
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Inline_Chained_Storage & Table) {
+}; // class Inline_Chained_Storage {
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Swiss table
+
+/* Each slot of a Swiss table has a one byte control value. A full slot's
+control byte holds 7 bits of its item's hash (so it's in [0, 127]). Empty and
+deleted slots have their high bit set. */
+const signed char Ctrl_Empty = -128;             // 0b10000000
+const signed char Ctrl_Deleted = -2;             // 0b11111110
+
+// Index of the lowest set bit in a (non-zero) mask
+inline unsigned Lowest_Bit(unsigned Mask) {
+  #if defined(__GNUC__)
+    return __builtin_ctz(Mask);
+  #else
+    unsigned i = 0;
+    while((Mask & 1) == 0) { Mask >>= 1; i++; }
+    return i;
+  #endif
+} // inline unsigned Lowest_Bit(unsigned Mask) {
+
+// Index of the highest set bit in a (non-zero) mask
+inline unsigned Highest_Bit(unsigned Mask) {
+  #if defined(__GNUC__)
+    return 31 - __builtin_clz(Mask);
+  #else
+    unsigned i = 0;
+    while(Mask >>= 1) { i++; }
+    return i;
+  #endif
+} // inline unsigned Highest_Bit(unsigned Mask) {
+
+
+
+/* A group of 16 consecutive control bytes. Each match method returns a 16 bit
+mask whose i'th bit is set if the i'th control byte in the group matches. With
+SSE2 each match is a single compare plus a movemask. */
+class Control_Group {
+  private:
+    #if defined(HASH_TABLE_SSE2)
+      __m128i Ctrl;
+    #else
+      const signed char* Ctrl;
+    #endif
+
+  public:
+    static const unsigned Width = 16;
+
+    #if defined(HASH_TABLE_SSE2)
+      explicit Control_Group(const signed char* Pos)
+        : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Pos))) {}
+
+      // Slots whose control byte is exactly h2
+      unsigned match(signed char h2) const {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), Ctrl));
+      } // unsigned match(signed char h2) const {
+
+      /* Empty and deleted control bytes are exactly the ones with their high
+      bit set, which is what movemask extracts. */
+      unsigned match_empty_or_deleted() const { return _mm_movemask_epi8(Ctrl); }
+
+    #else
+      explicit Control_Group(const signed char* Pos) : Ctrl(Pos) {}
+
+      unsigned match(signed char h2) const {
+        unsigned Mask = 0;
+        for(unsigned i = 0; i < Width; i++) {
+          if(Ctrl[i] == h2) { Mask |= (1u << i); }
+        } // for(unsigned i = 0; i < Width; i++) {
+        return Mask;
+      } // unsigned match(signed char h2) const {
+
+      unsigned match_empty_or_deleted() const {
+        unsigned Mask = 0;
+        for(unsigned i = 0; i < Width; i++) {
+          if(Ctrl[i] < 0) { Mask |= (1u << i); }
+        } // for(unsigned i = 0; i < Width; i++) {
+        return Mask;
+      } // unsigned match_empty_or_deleted() const {
+    #endif
+
+    unsigned match_empty() const { return match(Ctrl_Empty); }
+}; // class Control_Group {
+
+
+
+/* Swiss table storage engine (in the style of Abseil's flat_hash_map). Items
+are stored inline in a flat array of slots, and beside it we keep an array of
+one byte control values (see above). A key's hash is split in two: H1 (the
+upper bits) picks where the probe starts, and H2 (the lower 7 bits) is what we
+store in the control byte.
+
+Lookups probe a whole group of 16 control bytes at a time. Comparing H2
+against a group filters out almost every non-matching slot without touching
+the slots themselves, so a lookup usually reads one or two cache lines of
+control bytes plus the slot that holds the item. If the group has an empty
+slot then the key can't be further along the probe sequence, so we stop.
+
+The number of slots is always a power of two (at least 16), so this engine
+ignores the table's growth policy. The control array has 16 extra bytes at the
+end which mirror the first 16, so that a group can be loaded starting at any
+slot without wrapping around. */
+template <typename K, typename V, typename KeyHash, typename KeyEqual, typename Growth>
+class Swiss_Storage {
+  private:
+    unsigned N_Slots;
+    signed char* Ctrl;                     // N_Slots + Control_Group::Width bytes
+    Probe_Slot<K, V>* Slots;               // We only use the slots' storage
+
+    KeyHash Hasher;
+    KeyEqual Key_Equal;
+
+    unsigned N_Items;                      // Number of items in the table
+    unsigned Growth_Left;                  // Empty slots we can still fill
+    float Max_Load_Factor;                 // Largest allowed N_Items/N_Slots
+
+    /* Hashing function. Many hash functions (e.g. std::hash for integers)
+    are the identity, which would put all of a key's entropy in the bits we
+    use for H2, so we mix the hash first. */
+    uint64_t Hash(const K& key) const { return Mix_Hash(Hasher(key)); }
+
+    unsigned H1(uint64_t h) const { return (unsigned)(h >> 7) & (N_Slots - 1); }
+    static signed char H2(uint64_t h) { return (signed char)(h & 0x7F); }
+
+
+    /* Set the control byte for slot i. The first 16 control bytes are mirrored
+    past the end of the array, so those need to be set twice. */
+    void Set_Ctrl(unsigned i, signed char Value) {
+      Ctrl[i] = Value;
+      if(i < Control_Group::Width) { Ctrl[N_Slots + i] = Value; }
+    } // void Set_Ctrl(unsigned i, signed char Value) {
+
+
+    /* Max number of items that a table with N slots can hold. We always keep at
+    least one empty slot so that probing for a missing key terminates. */
+    unsigned Capacity(unsigned N) const {
+      unsigned Max_Items = (unsigned)(Max_Load_Factor*N);
+      return (Max_Items < N) ? Max_Items : N - 1;
+    } // unsigned Capacity(unsigned N) const {
+
+
+    /* Allocate N empty slots (N must be a power of two that is at least 16).
+    This doesn't free the old arrays. */
+    void Allocate(unsigned N) {
+      N_Slots = N;
+      Ctrl = new signed char[N + Control_Group::Width];
+      for(unsigned i = 0; i < N + Control_Group::Width; i++) { Ctrl[i] = Ctrl_Empty; }
+      Slots = new Probe_Slot<K, V>[N];
+      Growth_Left = Capacity(N) - N_Items;
+    } // void Allocate(unsigned N) {
+
+
+    /* Returns the index of the slot holding the item with the specified key,
+    or N_Slots if there is no such item.
+
+    We probe groups in triangular order (the group starts at H1, H1 + 16,
+    H1 + 16 + 32, ...). Since N_Slots is a power of two, this visits every
+    group before repeating one. */
+    unsigned Find_Slot(const K& key) const {
+      uint64_t h = Hash(key);
+      unsigned Pos = H1(h);
+      unsigned Step = 0;
+
+      while(true) {
+        Control_Group Group(Ctrl + Pos);
+
+        // Check every slot whose control byte matches H2.
+        for(unsigned Mask = Group.match(H2(h)); Mask != 0; Mask &= Mask - 1) {
+          unsigned i = (Pos + Lowest_Bit(Mask)) & (N_Slots - 1);
+          if(Key_Equal(Slots[i].item()->key, key) == true) { return i; }
+        } // for(unsigned Mask = Group.match(H2(h)); Mask != 0; Mask &= Mask - 1) {
+
+        // If the group has an empty slot then the key isn't in the table.
+        if(Group.match_empty() != 0) { return N_Slots; }
+
+        Step += Control_Group::Width;
+        Pos = (Pos + Step) & (N_Slots - 1);
+      } // while(true) {
+    } // unsigned Find_Slot(const K& key) const {
+
+
+    /* Returns the index of the first empty or deleted slot in the probe
+    sequence for hash h. There is always at least one empty slot. */
+    unsigned Find_Free_Slot(uint64_t h) const {
+      unsigned Pos = H1(h);
+      unsigned Step = 0;
+
+      while(true) {
+        unsigned Mask = Control_Group(Ctrl + Pos).match_empty_or_deleted();
+        if(Mask != 0) { return (Pos + Lowest_Bit(Mask)) & (N_Slots - 1); }
+
+        Step += Control_Group::Width;
+        Pos = (Pos + Step) & (N_Slots - 1);
+      } // while(true) {
+    } // unsigned Find_Free_Slot(uint64_t h) const {
+
+
+    // Delete the implicit = operator and copy constructor methods
+    Swiss_Storage(const Swiss_Storage &) = delete;
+    Swiss_Storage& operator=(const Swiss_Storage &) = delete;
+
+  public:
+    // Constructor, destructor
+    Swiss_Storage(unsigned N_Slots = 16, float Max_Load_Factor = 0.875,
+                  const KeyHash& Hasher = KeyHash(), const KeyEqual& Key_Equal = KeyEqual())
+        : Hasher(Hasher), Key_Equal(Key_Equal), N_Items(0) {
+      // Max load factor must be in (0, 1).
+      if(Max_Load_Factor <= 0 || Max_Load_Factor >= 1) { Max_Load_Factor = 0.875; }
+      Swiss_Storage::Max_Load_Factor = Max_Load_Factor;
+
+      // Round the number of slots up to a power of two (that is at least 16).
+      unsigned N = Control_Group::Width;
+      while(N < N_Slots) { N *= 2; }
+      Allocate(N);
+    } // Swiss_Storage(unsigned N_Slots = 16, float Max_Load_Factor = 0.875) {
+
+    ~Swiss_Storage() {
+      for(unsigned i = 0; i < N_Slots; i++) {
+        if(Ctrl[i] >= 0) { Slots[i].item()->~Item<K, V>(); }
+      } // for(unsigned i = 0; i < N_Slots; i++) {
+
+      delete [] Slots;
+      delete [] Ctrl;
+    } // ~Swiss_Storage() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned size() const { return N_Items; }
+    unsigned bucket_count() const { return N_Slots; }
+    float load_factor() const { return ((float)N_Items)/N_Slots; }
+    float max_load_factor() const { return Max_Load_Factor; }
+
+    // The slot that key's probe sequence starts at
+    unsigned bucket(const K& key) const { return H1(Hash(key)); }
+
+
+    /* Prefetch what a lookup of key will read (see Chained_Storage). Stage 0
+    prefetches the first group of control bytes. Stage 1 (once they've
+    arrived) prefetches the first slot in that group whose control byte
+    matches the key's H2, which is almost always the key's slot. */
+    static const unsigned Prefetch_Stages = 2;
+    void prefetch(const K& key, unsigned Stage) const {
+      uint64_t h = Hash(key);
+      unsigned Pos = H1(h);
+      if(Stage == 0) {
+        HASH_TABLE_PREFETCH(Ctrl + Pos);
+        return;
+      } // if(Stage == 0) {
+
+      unsigned Match = Control_Group(Ctrl + Pos).match(H2(h));
+      if(Match != 0) { HASH_TABLE_PREFETCH(&Slots[(Pos + Lowest_Bit(Match)) & (N_Slots - 1)]); }
+    } // void prefetch(const K& key, unsigned Stage) const {
+
+    /* Make room for N items (so that inserting until there are N items won't
+    rehash). If deleted slots have used up the room we'd otherwise have, this
+    rehashes (without growing) to clean them up. */
+    void reserve(unsigned N) {
+      unsigned New_N_Slots = N_Slots;
+      while(Capacity(New_N_Slots) < N) { New_N_Slots *= 2; }
+      if(New_N_Slots > N_Slots || (N > N_Items && Growth_Left < N - N_Items)) { rehash(New_N_Slots); }
+    } // void reserve(unsigned N) {
+
+    /* Set the max load factor. If the table is already fuller than the new
+    max load factor then it is grown immediately. */
+    void max_load_factor(float New_Max_Load_Factor) {
+      if(New_Max_Load_Factor <= 0 || New_Max_Load_Factor >= 1) { return; }
+      Max_Load_Factor = New_Max_Load_Factor;
+      rehash(N_Slots);
+    } // void max_load_factor(float New_Max_Load_Factor) {
+
+
+    /* Move every item into a new array of (at least) New_N_Slots slots. The
+    number of slots is rounded up to a power of two that can hold one more than
+    the current number of items. This also clears out deleted slots. */
+    void rehash(unsigned New_N_Slots) {
+      unsigned N = Control_Group::Width;
+      while(N < New_N_Slots || Capacity(N) <= N_Items) { N *= 2; }
+
+      signed char* Old_Ctrl = Ctrl;
+      Probe_Slot<K, V>* Old_Slots = Slots;
+      unsigned Old_N_Slots = N_Slots;
+
+      Allocate(N);
+
+      // Keys are unique, so every item just goes into its first free slot.
+      for(unsigned i = 0; i < Old_N_Slots; i++) {
+        if(Old_Ctrl[i] < 0) { continue; }
+
+        uint64_t h = Hash(Old_Slots[i].item()->key);
+        unsigned j = Find_Free_Slot(h);
+
+        new (Slots[j].item()) Item<K, V>(std::move(*Old_Slots[i].item()));
+        Set_Ctrl(j, H2(h));
+        Old_Slots[i].item()->~Item<K, V>();
+      } // for(unsigned i = 0; i < Old_N_Slots; i++) {
+
+      delete [] Old_Slots;
+      delete [] Old_Ctrl;
+    } // void rehash(unsigned New_N_Slots) {
+
+
+    /* If no item has the specified key, add one whose value is constructed
+    (in its slot) from args. Returns a pointer to the key's value and true if
+    the item is new. If the key was already in the table, args are left alone.
+    key should be a K (or reference to one). */
+    template<typename Key_Arg, typename... Args>
+    std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+      // If the key is already in the table, we're done.
+      unsigned i = Find_Slot(key);
+      if(i != N_Slots) { return std::pair<V*, bool>(&Slots[i].item()->value, false); }
+
+      uint64_t h = Hash(key);
+      i = Find_Free_Slot(h);
+
+      /* Filling an empty slot uses up some of our growth budget (reusing a
+      deleted slot doesn't). If we're out of budget then we need to rehash.
+      If at least half of the table's capacity is taken up by deleted slots,
+      rehashing into the same number of slots is enough to clean them up.
+      Otherwise, double the number of slots. */
+      if(Ctrl[i] == Ctrl_Empty && Growth_Left == 0) {
+        if(N_Items < Capacity(N_Slots)/2) { rehash(N_Slots); }
+        else { rehash(2*N_Slots); }
+        i = Find_Free_Slot(h);
+      } // if(Ctrl[i] == Ctrl_Empty && Growth_Left == 0) {
+
+      // Build the item before touching the control bytes, in case it throws.
+      bool Was_Empty = (Ctrl[i] == Ctrl_Empty);
+      new (Slots[i].item()) Item<K, V>(std::forward<Key_Arg>(key), std::forward<Args>(args)...);
+      if(Was_Empty == true) { Growth_Left--; }
+      Set_Ctrl(i, H2(h));
+      N_Items++;
+      return std::pair<V*, bool>(&Slots[i].item()->value, true);
+    } // std::pair<V*, bool> try_emplace(Key_Arg&& key, Args&&... args) {
+
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      unsigned i = Find_Slot(key);
+      if(i == N_Slots) { return; }
+
+      Slots[i].item()->~Item<K, V>();
+      N_Items--;
+
+      /* If every 16 slot window containing slot i has an empty slot, then no
+      probe ever passed through slot i while it was full (a probe would have
+      stopped at the empty slot). In that case, we can mark slot i as empty.
+      Otherwise, a probe for some other key may need to get past slot i, so
+      we mark it as deleted (a tombstone). */
+      unsigned Before = (i - Control_Group::Width) & (N_Slots - 1);
+      unsigned Empty_After = Control_Group(Ctrl + i).match_empty();
+      unsigned Empty_Before = Control_Group(Ctrl + Before).match_empty();
+
+      bool Was_Never_Full = (Empty_Before != 0 && Empty_After != 0 &&
+                             Lowest_Bit(Empty_After) + (Control_Group::Width - 1 - Highest_Bit(Empty_Before))
+                               < Control_Group::Width);
+
+      if(Was_Never_Full == true) {
+        Set_Ctrl(i, Ctrl_Empty);
+        Growth_Left++;
+      } // if(Was_Never_Full == true) {
+      else { Set_Ctrl(i, Ctrl_Deleted); }
+    } // void remove(const K& key) {
+
+
+    /* Find the value of the item with the specified key. Returns NULL if no
+    item has that key. */
+    V* find(const K& key) {
+      unsigned i = Find_Slot(key);
+      return (i == N_Slots) ? NULL : &Slots[i].item()->value;
+    } // V* find(const K& key) {
+
+    const V* find(const K& key) const {
+      unsigned i = Find_Slot(key);
+      return (i == N_Slots) ? NULL : &Slots[i].item()->value;
+    } // const V* find(const K& key) const {
+
+
+    // Printing method
+    friend std::ostream & operator<<(std::ostream & os, const Swiss_Storage & Table) {
+      unsigned N_Slots = Table.N_Slots;
+      for(unsigned i = 0; i < N_Slots; i++) {
+        os << "Slot " << i << ": ";
+        if(Table.Ctrl[i] >= 0) {
+          os << "{" << Table.Slots[i].item()->key << " : " << Table.Slots[i].item()->value << "}";
+        } // if(Table.Ctrl[i] >= 0) {
+        os << std::endl;
+      } // for(unsigned i = 0; i < N_Slots; i++) {
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Swiss_Storage & Table) {
+}; // class Swiss_Storage {
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Hash table
+
+/* The hash table itself. K is the key type and V is the value type. Keys are
+hashed with Hash and compared with KeyEqual (by default, std::hash and
+std::equal_to, so any key type that works with std::unordered_map works here).
+Storage selects how the table stores its items:
+    Chained_Storage: Each bucket is a linked list of items (the default).
+    Unrolled_Storage: Each bucket is a linked list of cache line sized
+      chunks, each of which holds several items.
+    Inline_Chained_Storage: Each bucket holds its first item itself, and any
+      other items are in a linked list.
+    Linear_Probe_Storage: Items are stored inline in one flat array and
+      collisions are resolved with linear probing.
+    Robin_Hood_Storage: Like Linear_Probe_Storage, but uses Robin Hood
+      hashing to keep probe lengths short at high load factors.
+    Swiss_Storage: Items are stored inline in one flat array with a control
+      byte per slot, and lookups probe 16 control bytes at a time.
+Every engine provides the same interface (try_emplace, remove, find, size,
+bucket, reserve, rehash, prefetch, printing, etc.), and the table adds the
+updates that are built on try_emplace (insert, emplace, insert_or_assign,
+upsert, compute) and the lookups that are built on find (search, contains,
+get_or, search_batch). Every engine's constructor takes the initial number of
+buckets/slots, the max load factor, and (optionally) Hash and KeyEqual objects.
+
+Growth selects the bucket counts the table uses and how hashes are mapped to
+buckets (see Modulo_Growth, Power_Of_Two_Growth, and Prime_Growth). */
+template <typename K, typename V,
+          typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>,
+          template<typename, typename, typename, typename, typename> class Storage = Chained_Storage,
+          typename Growth = Modulo_Growth>
+class Hash_Table : public Storage<K, V, Hash, KeyEqual, Growth> {
+  private:
+    static void Throw_Invalid_Key(const K& key) {
+      char Error_Message_Buffer[500];
+      snprintf(Error_Message_Buffer, sizeof(Error_Message_Buffer),
+               "Invalid Key Error: This hash table does not have an entry with key %s\n",
+               Describe_Key(key).c_str());
+      throw Invalid_Key(Error_Message_Buffer);
+    } // static void Throw_Invalid_Key(const K& key) {
+
+    // Insert a range of items one at a time (used when we can't size the range up front).
+    template<typename Iterator>
+    void Insert_Range(Iterator First, Iterator Last, std::input_iterator_tag) {
+      for(; First != Last; ++First) { insert(First->first, First->second); }
+    } // void Insert_Range(Iterator First, Iterator Last, std::input_iterator_tag) {
+
+    /* Insert a range of items whose length we can measure. We make room for
+    all of them first, then hash the whole batch and insert the items in bucket
+    order, so the inserts sweep through the table once rather than jumping
+    around it. Sorting exactly by bucket would cost more than it saves, so we
+    split the buckets into (up to) 4096 contiguous regions and counting sort the
+    items by region.
+
+    The items are copied into a buffer in region order (so that the inserts
+    read them in order too) and then moved from there into the table. The sort
+    is stable, so if a key appears more than once the last value wins (as it
+    would inserting one at a time). */
+    template<typename Iterator>
+    void Insert_Range(Iterator First, Iterator Last, std::forward_iterator_tag) {
+      const unsigned N = (unsigned)std::distance(First, Last);
+      this->reserve(this->size() + N);
+
+      const uint64_t N_Buckets = this->bucket_count();
+      const unsigned N_Regions = (N_Buckets < 4096) ? (unsigned)N_Buckets : 4096;
+
+      // Find each item's region, and count how many items land in each region.
+      std::vector<unsigned> Region(N);
+      std::vector<unsigned> Region_Start(N_Regions + 1, 0);
+      Iterator It = First;
+      for(unsigned i = 0; i < N; i++, ++It) {
+        Region[i] = (unsigned)(this->bucket(It->first)*N_Regions/N_Buckets);
+        Region_Start[Region[i] + 1]++;
+      } // for(unsigned i = 0; i < N; i++, ++It) {
+      for(unsigned r = 0; r < N_Regions; r++) { Region_Start[r + 1] += Region_Start[r]; }
+
+      /* Copy the items into the buffer in region order, then move them into
+      the table. The buffer's slots start out unoccupied, so if anything
+      throws we only destroy the items we actually made. */
+      std::vector< Probe_Slot<K, V> > Ordered(N);
+      try {
+        It = First;
+        for(unsigned i = 0; i < N; i++, ++It) {
+          Probe_Slot<K, V>& Slot = Ordered[Region_Start[Region[i]]++];
+          new (Slot.item()) Item<K, V>(It->first, It->second);
+          Slot.Occupied = true;
+        } // for(unsigned i = 0; i < N; i++, ++It) {
+
+        for(unsigned i = 0; i < N; i++) {
+          insert_or_assign(std::move(Ordered[i].item()->key), std::move(Ordered[i].item()->value));
+        } // for(unsigned i = 0; i < N; i++) {
+      } // try {
+      catch(...) {
+        Destroy_Items(Ordered);
+        throw;
+      } // catch(...) {
+
+      Destroy_Items(Ordered);
+    } // void Insert_Range(Iterator First, Iterator Last, std::forward_iterator_tag) {
+
+    static void Destroy_Items(std::vector< Probe_Slot<K, V> >& Slots) {
+      for(unsigned i = 0; i < Slots.size(); i++) {
+        if(Slots[i].Occupied == true) { Slots[i].item()->~Item<K, V>(); }
+      } // for(unsigned i = 0; i < Slots.size(); i++) {
+    } // static void Destroy_Items(std::vector< Probe_Slot<K, V> >& Slots) {
+
+  public:
+    // Use the engine's constructors (and its defaults).
+    using Storage<K, V, Hash, KeyEqual, Growth>::Storage;
+
+    /* The engine's find returns a pointer to the value of the item with the
+    specified key, or NULL if there is no such item. It never throws or
+    allocates, so it (or contains/get_or) is the way to look up keys that may
+    not be in the table. */
+    using Storage<K, V, Hash, KeyEqual, Growth>::find;
+
+    /* The engine's try_emplace(key, args...) adds an item whose value is
+    constructed from args (directly in the table's storage) if no item has the
+    specified key. It returns a pointer to the key's value and true if a new
+    item was added. If the key was already in the table, the existing value is
+    left alone and args aren't touched (so they can still be moved from). */
+    using Storage<K, V, Hash, KeyEqual, Growth>::try_emplace;
+
+
+    /* Insert an item into the table. If an item with the specified key is
+    already in the table, its value is updated. */
+    void insert(const K& key, const V& value) { insert_or_assign(key, value); }
+
+    /* Insert every item in [First, Last), which should be (key, value) pairs
+    (e.g. from a std::map or a vector of std::pairs). If the length of the
+    range can be measured, the table makes room for the whole range up front
+    and inserts the items grouped by bucket. */
+    template<typename Iterator, typename = typename std::enable_if<std::is_convertible<
+               typename std::iterator_traits<Iterator>::iterator_category, std::input_iterator_tag>::value>::type>
+    void insert(Iterator First, Iterator Last) {
+      Insert_Range(First, Last, typename std::iterator_traits<Iterator>::iterator_category());
+    } // void insert(Iterator First, Iterator Last) {
+
+
+    /* Add an item whose value is constructed from args, unless an item with
+    the specified key is already in the table. Returns true if a new item was
+    added. */
+    template<typename... Args>
+    bool emplace(const K& key, Args&&... args) { return try_emplace(key, std::forward<Args>(args)...).second; }
+
+    template<typename... Args>
+    bool emplace(K&& key, Args&&... args) { return try_emplace(std::move(key), std::forward<Args>(args)...).second; }
+
+
+    /* Set the value of the item with the specified key to value. If there is
+    no such item, a new one is added with a value constructed from value (so
+    passing an rvalue moves it into the table either way). Returns a pointer to
+    the key's value and true if a new item was added. */
+    template<typename M>
+    std::pair<V*, bool> insert_or_assign(const K& key, M&& value) {
+      std::pair<V*, bool> Result = try_emplace(key, std::forward<M>(value));
+      if(Result.second == false) { *Result.first = std::forward<M>(value); }
+      return Result;
+    } // std::pair<V*, bool> insert_or_assign(const K& key, M&& value) {
+
+    template<typename M>
+    std::pair<V*, bool> insert_or_assign(K&& key, M&& value) {
+      std::pair<V*, bool> Result = try_emplace(std::move(key), std::forward<M>(value));
+      if(Result.second == false) { *Result.first = std::forward<M>(value); }
+      return Result;
+    } // std::pair<V*, bool> insert_or_assign(K&& key, M&& value) {
+
+
+    /* Find the value of the item with the specified key. Throws an exception
+    if no item with the specified key can be found. This returns a reference
+    to the value in the table (so nothing is copied), which stays valid until
+    the item is removed. With engines other than Chained_Storage, items can
+    also move when other items are added or removed, or the table is rehashed,
+    so the reference is only good until the table is next changed. */
+    const V& search(const K& key) const {
+      const V* Value = find(key);
+      if(Value == NULL) { Throw_Invalid_Key(key); }
+      return *Value;
+    } // const V& search(const K& key) const {
+
+    V& search(const K& key) {
+      V* Value = find(key);
+      if(Value == NULL) { Throw_Invalid_Key(key); }
+      return *Value;
+    } // V& search(const K& key) {
+
+
+    /* Update the value of the item with the specified key in place by calling
+    Fn(Value), where Value is a reference to the item's value. Returns false
+    (without calling Fn) if there is no item with the specified key. */
+    template<typename Function>
+    bool modify(const K& key, Function Fn) {
+      V* Value = find(key);
+      if(Value == NULL) { return false; }
+
+      Fn(*Value);
+      return true;
+    } // bool modify(const K& key, Function Fn) {
+
+
+    /* Merge a value into the table. If no item has the specified key, a new
+    item is added with value init. Otherwise, Merge(Value, init) is called,
+    where Value is a reference to the existing item's value (so Merge should
+    update it in place, e.g. [](unsigned& Count, unsigned n) { Count += n; }).
+    Either way the key is only looked up once. Returns true if a new item was
+    added. */
+    template<typename Function>
+    bool upsert(const K& key, const V& init, Function Merge) {
+      std::pair<V*, bool> Result = try_emplace(key, init);
+      if(Result.second == false) { Merge(*Result.first, init); }
+      return Result.second;
+    } // bool upsert(const K& key, const V& init, Function Merge) {
+
+
+    /* Call Fn(Value), where Value is a reference to the value of the item
+    with the specified key. If there is no such item, one is added first with
+    a value-initialized value (e.g. 0 for numbers), so
+    compute(key, [](unsigned& Count) { Count++; }) counts keys. The key is only
+    looked up once. Returns true if a new item was added. */
+    template<typename Function>
+    bool compute(const K& key, Function Fn) {
+      std::pair<V*, bool> Result = try_emplace(key);
+      Fn(*Result.first);
+      return Result.second;
+    } // bool compute(const K& key, Function Fn) {
+
+
+    /* Look up N keys at once. For each i, if Keys[i] is in the table then its
+    value is copied into Out[i] and bit i of Found_Mask is set (bit i is bit
+    i % 64 of Found_Mask[i / 64], so Found_Mask needs (N + 63)/64 words). If
+    it isn't, Out[i] is left alone and the bit is cleared. Returns the number
+    of keys that were found.
+
+    Lookups mostly wait on cache misses, and one lookup's misses can't start
+    until the previous lookup is done. So we work on groups of keys: first we
+    prefetch every key's bucket (and then, in later stages, whatever the
+    engine reads next; see the engines' prefetch), and only then look the keys
+    up. That way the misses for the whole group overlap. Each stage hashes
+    the key again, which is cheap next to a cache miss for simple keys. */
+    unsigned search_batch(const K* Keys, unsigned N, V* Out, uint64_t* Found_Mask) const {
+      static const unsigned Group_Size = 16;
+      typedef Storage<K, V, Hash, KeyEqual, Growth> Engine;
+
+      for(unsigned i = 0; i < (N + 63)/64; i++) { Found_Mask[i] = 0; }
+
+      unsigned N_Found = 0;
+      for(unsigned Group_Start = 0; Group_Start < N; Group_Start += Group_Size) {
+        unsigned Group_End = (N - Group_Start < Group_Size) ? N : Group_Start + Group_Size;
+
+        for(unsigned Stage = 0; Stage < Engine::Prefetch_Stages; Stage++) {
+          for(unsigned i = Group_Start; i < Group_End; i++) { this->prefetch(Keys[i], Stage); }
+        } // for(unsigned Stage = 0; Stage < Engine::Prefetch_Stages; Stage++) {
+
+        for(unsigned i = Group_Start; i < Group_End; i++) {
+          const V* Value = find(Keys[i]);
+          if(Value == NULL) { continue; }
+
+          Out[i] = *Value;
+          Found_Mask[i/64] |= (uint64_t)1 << (i % 64);
+          N_Found++;
+        } // for(unsigned i = Group_Start; i < Group_End; i++) {
+      } // for(unsigned Group_Start = 0; Group_Start < N; Group_Start += Group_Size) {
+
+      return N_Found;
+    } // unsigned search_batch(const K* Keys, unsigned N, V* Out, uint64_t* Found_Mask) const {
+
+
+    #if defined(HASH_TABLE_COROUTINES)
+      /* Look up N keys at once, like search_batch, using N_In_Flight lookup
+      tasks (coroutines) that are interleaved with each other. Whenever a
+      lookup is about to read memory that's probably not in cache, it
+      prefetches it and lets the next lookup run (see Lookup_Task), so up to
+      N_In_Flight cache misses can be outstanding at a time. Unlike
+      search_batch, this follows the whole chain, not just its first node.
+      N_In_Flight = 0 is treated as 1.
+
+      This needs C++20, and is only available with Chained_Storage. */
+      unsigned search_interleaved(const K* Keys, unsigned N, V* Out, uint64_t* Found_Mask,
+                                  unsigned N_In_Flight = 8) const {
+        for(unsigned i = 0; i < (N + 63)/64; i++) { Found_Mask[i] = 0; }
+
+        Lookup_Batch<K, V> Batch = {Keys, N, 0, Out, Found_Mask, 0};
+        if(N_In_Flight == 0) { N_In_Flight = 1; }
+        if(N_In_Flight > N) { N_In_Flight = N; }
+
+        std::vector<Lookup_Task> Tasks;
+        Tasks.reserve(N_In_Flight);
+        for(unsigned i = 0; i < N_In_Flight; i++) { Tasks.push_back(this->lookup_task(Batch)); }
+        Run_Interleaved(Tasks);
+
+        return Batch.N_Found;
+      } // unsigned search_interleaved(const K* Keys, unsigned N, V* Out, uint64_t* Found_Mask, ...
+    #endif
+
+
+    // Returns true if the table has an item with the specified key.
+    bool contains(const K& key) const { return find(key) != NULL; }
+
+
+    /* Returns the value of the item with the specified key, or Default if
+    there is no such item. */
+    V get_or(const K& key, const V& Default) const {
+      const V* Value = find(key);
+      return (Value != NULL) ? *Value : Default;
+    } // V get_or(const K& key, const V& Default) const {
+}; // class Hash_Table : public Storage<K, V, Hash, KeyEqual, Growth> {
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Concurrent hash tables
+
+/* Nothing above is thread safe: a Hash_Table can be used by several threads at
+once only if they all just read it. The tables in this section can be used
+by any number of threads at once. */
+
+
+/* A fixed size array of N objects of type T, aligned to alignof(T). The
+concurrent tables use these for things that are cache line aligned (so that
+threads using neighbouring elements don't write to the same cache line).
+operator new only promises the alignment of the fundamental types, so (as in
+Slab_Pool) we allocate a little extra and round the start up. */
+template<typename T>
+class Aligned_Array {
+  private:
+    void* Memory;                          // What we allocated Elements from
+    T* Elements;
+    unsigned N;
+
+    Aligned_Array(const Aligned_Array &) = delete;
+    Aligned_Array& operator=(const Aligned_Array &) = delete;
+
+  public:
+    // Construct N elements, each from args.
+    template<typename... Args>
+    Aligned_Array(unsigned N, const Args&... args) : N(N) {
+      const size_t Alignment = alignof(T);
+      Memory = ::operator new(N*sizeof(T) + Alignment - 1);
+      uintptr_t First = (reinterpret_cast<uintptr_t>(Memory) + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+      Elements = reinterpret_cast<T*>(First);
+
+      // If constructing an element throws, destroy the ones we already made.
+      unsigned i = 0;
+      try {
+        for(; i < N; i++) { new (&Elements[i]) T(args...); }
+      } // try {
+      catch(...) {
+        while(i > 0) { Elements[--i].~T(); }
+        ::operator delete(Memory);
+        throw;
+      } // catch(...) {
+    } // Aligned_Array(unsigned N, const Args&... args) : N(N) {
+
+    ~Aligned_Array() {
+      for(unsigned i = 0; i < N; i++) { Elements[i].~T(); }
+      ::operator delete(Memory);
+    } // ~Aligned_Array() {
+
+    unsigned size() const { return N; }
+    T& operator[](unsigned i) const { return Elements[i]; }
+}; // class Aligned_Array {
+
+
+
+// The smallest power of two that is at least N (and at least 1).
+inline unsigned Power_Of_Two_At_Least(unsigned N) {
+  unsigned Power = 1;
+  while(Power < N) { Power *= 2; }
+  return Power;
+} // inline unsigned Power_Of_Two_At_Least(unsigned N) {
+
+// log base 2 of a power of two
+inline unsigned Log2(unsigned Power) {
+  unsigned Log = 0;
+  while(Power > 1) {
+    Power /= 2;
+    Log++;
+  } // while(Power > 1) {
+  return Log;
+} // inline unsigned Log2(unsigned Power) {
+
+
+
+/* A hash table that is split into N_Stripes stripes. Each stripe is a
+Hash_Table (with the given Storage and Growth) guarded by its own lock, and
+each key belongs to one stripe (chosen from the key's hash). An operation
+only locks its key's stripe, so operations on keys in different stripes run
+in parallel. Each stripe grows on its own, so growing never stops the whole
+table.
+
+Stripes are cache line aligned (which pads them to a multiple of 64 bytes),
+so threads working in different stripes never write to the same cache line.
+
+Values can't be handed out by pointer or reference (another thread could
+change or remove them as soon as the stripe is unlocked), so lookups copy the
+value out, and in-place updates (modify, upsert, compute) call the given
+function while holding the stripe's lock. Those functions must not use the
+table. size and printing lock one stripe at a time, so they don't see a
+snapshot of the whole table if other threads are changing it. */
+template <typename K, typename V,
+          typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>,
+          template<typename, typename, typename, typename, typename> class Storage = Chained_Storage,
+          typename Growth = Modulo_Growth>
+class Striped_Hash_Table {
+  private:
+    typedef Hash_Table<K, V, Hash, KeyEqual, Storage, Growth> Table;
+
+    // A lock stripe: a lock, and the part of the table it guards.
+    struct alignas(64) Stripe {
+      mutable std::mutex Lock;
+      Table Items;
+
+      Stripe(unsigned N_Buckets, float Max_Load_Factor, const Hash& Hasher, const KeyEqual& Key_Equal)
+        : Items(N_Buckets, Max_Load_Factor, Hasher, Key_Equal) {}
+    }; // struct alignas(64) Stripe {
+
+    typedef std::lock_guard<std::mutex> Lock_Guard;
+
+    unsigned N_Stripes;                    // A power of two
+    unsigned Stripe_Shift;                 // 64 - log2(N_Stripes)
+    Hash Hasher;
+    Aligned_Array<Stripe> Stripes;
+
+    /* The stripe that key belongs to. Stripes use the high bits of a
+    Fibonacci hash of the key's hash, rather than its low bits, so that which
+    stripe a key is in says little about which bucket it's in within the
+    stripe (otherwise, with Power_Of_Two_Growth, each stripe would only use a
+    fraction of its buckets). */
+    unsigned Stripe_Index(const K& key) const {
+      if(N_Stripes == 1) { return 0; }
+      return (unsigned)(((uint64_t)Hasher(key)*0x9E3779B97F4A7C15ull) >> Stripe_Shift);
+    } // unsigned Stripe_Index(const K& key) const {
+
+    Stripe& Stripe_Of(const K& key) const { return Stripes[Stripe_Index(key)]; }
+
+    // Delete the implicit = operator and copy constructor methods
+    Striped_Hash_Table(const Striped_Hash_Table &) = delete;
+    Striped_Hash_Table& operator=(const Striped_Hash_Table &) = delete;
+
+  public:
+    /* Constructor, destructor. N_Stripes is rounded up to a power of two. The
+    N_Buckets buckets are split evenly between the stripes, and each stripe
+    uses the given max load factor (0 means the storage engine's default). */
+    Striped_Hash_Table(unsigned N_Stripes = 64, unsigned N_Buckets = 0, float Max_Load_Factor = 0,
+                       const Hash& Hasher = Hash(), const KeyEqual& Key_Equal = KeyEqual())
+        : N_Stripes(Power_Of_Two_At_Least(N_Stripes)), Stripe_Shift(64 - Log2(Striped_Hash_Table::N_Stripes)), Hasher(Hasher),
+          Stripes(Striped_Hash_Table::N_Stripes, N_Buckets/Striped_Hash_Table::N_Stripes, Max_Load_Factor, Hasher, Key_Equal) {} // Striped_Hash_Table(unsigned N_Stripes = 64, unsigned N_Buckets = 0, float Max_Load_Factor = 0, ...
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned stripe_count() const { return N_Stripes; }
+
+    // The stripe that key belongs to
+    unsigned stripe(const K& key) const { return Stripe_Index(key); }
+
+    // Total number of items (and buckets) in every stripe.
+    unsigned size() const {
+      unsigned N = 0;
+      for(unsigned i = 0; i < N_Stripes; i++) {
+        Lock_Guard Guard(Stripes[i].Lock);
+        N += Stripes[i].Items.size();
+      } // for(unsigned i = 0; i < N_Stripes; i++) {
+      return N;
+    } // unsigned size() const {
+
+    unsigned bucket_count() const {
+      unsigned N = 0;
+      for(unsigned i = 0; i < N_Stripes; i++) {
+        Lock_Guard Guard(Stripes[i].Lock);
+        N += Stripes[i].Items.bucket_count();
+      } // for(unsigned i = 0; i < N_Stripes; i++) {
+      return N;
+    } // unsigned bucket_count() const {
+
+    float load_factor() const { return ((float)size())/bucket_count(); }
+
+    // Every stripe has the same max load factor.
+    float max_load_factor() const {
+      Lock_Guard Guard(Stripes[0].Lock);
+      return Stripes[0].Items.max_load_factor();
+    } // float max_load_factor() const {
+
+    // Make room for N items (split evenly between the stripes).
+    void reserve(unsigned N) {
+      for(unsigned i = 0; i < N_Stripes; i++) {
+        Lock_Guard Guard(Stripes[i].Lock);
+        Stripes[i].Items.reserve(N/N_Stripes + 1);
+      } // for(unsigned i = 0; i < N_Stripes; i++) {
+    } // void reserve(unsigned N) {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Updates
+
+    /* Insert an item into the table. If an item with the specified key is
+    already in the table, its value is updated. */
+    void insert(const K& key, const V& value) { insert_or_assign(key, value); }
+
+    /* Set the value of the item with the specified key to value (adding an
+    item if there isn't one). Returns true if a new item was added. */
+    template<typename M>
+    bool insert_or_assign(const K& key, M&& value) {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+      return Key_Stripe.Items.insert_or_assign(key, std::forward<M>(value)).second;
+    } // bool insert_or_assign(const K& key, M&& value) {
+
+    /* Add an item whose value is constructed from args, unless an item with
+    the specified key is already in the table. Returns true if a new item was
+    added. */
+    template<typename... Args>
+    bool emplace(const K& key, Args&&... args) {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+      return Key_Stripe.Items.emplace(key, std::forward<Args>(args)...);
+    } // bool emplace(const K& key, Args&&... args) {
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+      Key_Stripe.Items.remove(key);
+    } // void remove(const K& key) {
+
+    /* Update the value of the item with the specified key in place by calling
+    Fn(Value) (while holding the key's stripe's lock). Returns false (without
+    calling Fn) if there is no item with the specified key. */
+    template<typename Function>
+    bool modify(const K& key, Function Fn) {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+      return Key_Stripe.Items.modify(key, Fn);
+    } // bool modify(const K& key, Function Fn) {
+
+    // See Hash_Table::upsert. Merge is called while holding the stripe's lock.
+    template<typename Function>
+    bool upsert(const K& key, const V& init, Function Merge) {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+      return Key_Stripe.Items.upsert(key, init, Merge);
+    } // bool upsert(const K& key, const V& init, Function Merge) {
+
+    // See Hash_Table::compute. Fn is called while holding the stripe's lock.
+    template<typename Function>
+    bool compute(const K& key, Function Fn) {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+      return Key_Stripe.Items.compute(key, Fn);
+    } // bool compute(const K& key, Function Fn) {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Lookups
+
+    /* Returns (a copy of) the value of the item with the specified key. Throws
+    an exception if no item with the specified key can be found. */
+    V search(const K& key) const {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+      return Key_Stripe.Items.search(key);
+    } // V search(const K& key) const {
+
+    /* If an item has the specified key, copy its value into Value and return
+    true. Otherwise, return false (and leave Value alone). */
+    bool find(const K& key, V& Value) const {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+
+      const V* Found = Key_Stripe.Items.find(key);
+      if(Found == NULL) { return false; }
+      Value = *Found;
+      return true;
+    } // bool find(const K& key, V& Value) const {
+
+    // Returns true if the table has an item with the specified key.
+    bool contains(const K& key) const {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+      return Key_Stripe.Items.contains(key);
+    } // bool contains(const K& key) const {
+
+    /* Returns the value of the item with the specified key, or Default if
+    there is no such item. */
+    V get_or(const K& key, const V& Default) const {
+      Stripe& Key_Stripe = Stripe_Of(key);
+      Lock_Guard Guard(Key_Stripe.Lock);
+      return Key_Stripe.Items.get_or(key, Default);
+    } // V get_or(const K& key, const V& Default) const {
+
+
+    // Printing method
+    friend std::ostream & operator<<(std::ostream & os, const Striped_Hash_Table & Table) {
+      for(unsigned i = 0; i < Table.N_Stripes; i++) {
+        Lock_Guard Guard(Table.Stripes[i].Lock);
+        os << "Stripe " << i << ":" << std::endl << Table.Stripes[i].Items;
+      } // for(unsigned i = 0; i < Table.N_Stripes; i++) {
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Striped_Hash_Table & Table) {
+}; // class Striped_Hash_Table {
+
+
+
+/* Epoch based reclamation. A lock-free reader can be looking at a node at any
+time, so a writer that unlinks a node can't free it straight away. Instead it
+retires the node to an Epoch_Domain, which frees it once every reader that
+could have seen it is done.
+
+The domain has a global epoch. A reader pins the current epoch (with an
+Epoch_Guard) for as long as it's looking at shared nodes. Pins are counted
+in a set of cache line sized slots (each thread uses the slot its id hashes
+to, so threads rarely share one) with one count for even epochs and one for
+odd epochs. The epoch can move from e to e + 1 once nobody is pinned at
+e - 1 (whose count shares e + 1's parity). Something retired during epoch e
+was unlinked before any reader pinned at e + 1 or later started, and once the
+epoch reaches e + 2, nobody is pinned at e or earlier, so it can be freed.
+
+Retiring doesn't lock either. Each slot also has a lock-free stack of the
+objects that threads using the slot have retired. Retiring pushes onto the
+stack (with a compare and swap). Once enough have built up, the retiring
+thread takes the whole stack (with an exchange, so threads sharing a slot
+never collect the same objects), frees what it can, and pushes the rest
+back. Nothing is ever popped off one at a time, so there's no ABA problem. */
+class Epoch_Domain {
+  private:
+    // Something that has been retired, and the epoch it was retired in.
+    struct Retired_Object {
+      void* Object;
+      void (*Delete)(void*);
+      uint64_t Epoch;
+      Retired_Object* Next;
+    }; // struct Retired_Object {
+
+    /* One slot's pin counts (indexed by epoch parity) and retired objects.
+    We try to free the slot's retired objects once there are Collect_At of
+    them. */
+    struct alignas(64) Epoch_Slot {
+      std::atomic<unsigned> Pinned[2];
+      std::atomic<Retired_Object*> Retired;
+      std::atomic<unsigned> N_Retired;
+      std::atomic<unsigned> Collect_At;
+
+      Epoch_Slot() : Retired(NULL), N_Retired(0), Collect_At(Collect_Threshold) {
+        Pinned[0].store(0);
+        Pinned[1].store(0);
+      } // Epoch_Slot() : Retired(NULL), N_Retired(0), Collect_At(Collect_Threshold) {
+    }; // struct alignas(64) Epoch_Slot {
+
+    static const unsigned N_Slots = 64;
+
+    /* A slot's retired objects are collected once this many have built up. If
+    a collection can't free most of them (because someone has been pinned for
+    a while), we wait for twice as many as are left before trying again, so
+    that retiring doesn't rescan the whole stack every time. */
+    static const unsigned Collect_Threshold = 64;
+
+    std::atomic<uint64_t> Global_Epoch;
+    Aligned_Array<Epoch_Slot> Slots;
+
+    Epoch_Domain(const Epoch_Domain &) = delete;
+    Epoch_Domain& operator=(const Epoch_Domain &) = delete;
+
+    // The slot this thread pins epochs (and retires objects) in.
+    Epoch_Slot& Thread_Slot() const {
+      static thread_local unsigned Slot = (unsigned)std::hash<std::thread::id>()(std::this_thread::get_id()) % N_Slots;
+      return Slots[Slot];
+    } // Epoch_Slot& Thread_Slot() const {
+
+    // Push the chain of retired objects from First to Last onto Slot's stack.
+    static void Push(Epoch_Slot& Slot, Retired_Object* First, Retired_Object* Last) {
+      Retired_Object* Top = Slot.Retired.load(std::memory_order_relaxed);
+      do {
+        Last->Next = Top;
+      } while(Slot.Retired.compare_exchange_weak(Top, First, std::memory_order_release, std::memory_order_relaxed) == false);
+    } // static void Push(Epoch_Slot& Slot, Retired_Object* First, Retired_Object* Last) {
+
+    // Advance the epoch if nobody is pinned at the previous one. Returns the (new) epoch.
+    uint64_t Try_Advance() {
+      uint64_t Epoch = Global_Epoch.load();
+
+      // Pins made before this fence are visible to the loads below.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      bool Quiet = true;
+      for(unsigned i = 0; i < N_Slots && Quiet == true; i++) {
+        if(Slots[i].Pinned[(Epoch + 1) % 2].load() != 0) { Quiet = false; }
+      } // for(unsigned i = 0; i < N_Slots && Quiet == true; i++) {
+      if(Quiet == true) { Global_Epoch.compare_exchange_strong(Epoch, Epoch + 1); }
+      return Global_Epoch.load();
+    } // uint64_t Try_Advance() {
+
+    /* Free everything on Slot's stack that was retired at least two epochs
+    before Epoch, and put the rest back. */
+    static void Collect(Epoch_Slot& Slot, uint64_t Epoch) {
+      Retired_Object* Kept_First = NULL;
+      Retired_Object* Kept_Last = NULL;
+      unsigned N_Freed = 0, N_Kept = 0;
+
+      Retired_Object* Next;
+      for(Retired_Object* R = Slot.Retired.exchange(NULL, std::memory_order_acquire); R != NULL; R = Next) {
+        Next = R->Next;
+        if(R->Epoch + 2 <= Epoch) {
+          R->Delete(R->Object);
+          delete R;
+          N_Freed++;
+        } // if(R->Epoch + 2 <= Epoch) {
+        else {
+          R->Next = Kept_First;
+          Kept_First = R;
+          if(Kept_Last == NULL) { Kept_Last = R; }
+          N_Kept++;
+        } // else
+      } // for(Retired_Object* R = Slot.Retired.exchange(NULL, std::memory_order_acquire); R != NULL; R = Next) {
+
+      if(Kept_First != NULL) { Push(Slot, Kept_First, Kept_Last); }
+      Slot.N_Retired.fetch_sub(N_Freed, std::memory_order_relaxed);
+      Slot.Collect_At.store((2*N_Kept > Collect_Threshold) ? 2*N_Kept : Collect_Threshold, std::memory_order_relaxed);
+    } // static void Collect(Epoch_Slot& Slot, uint64_t Epoch) {
+
+  public:
+    Epoch_Domain() : Global_Epoch(2), Slots(N_Slots) {}
+
+    /* Nobody can be using the domain when it's destroyed, so everything that
+    is still retired can be freed. */
+    ~Epoch_Domain() {
+      for(unsigned i = 0; i < N_Slots; i++) {
+        Retired_Object* Next;
+        for(Retired_Object* R = Slots[i].Retired.load(); R != NULL; R = Next) {
+          Next = R->Next;
+          R->Delete(R->Object);
+          delete R;
+        } // for(Retired_Object* R = Slots[i].Retired.load(); R != NULL; R = Next) {
+      } // for(unsigned i = 0; i < N_Slots; i++) {
+    } // ~Epoch_Domain() {
+
+
+    /* Pin the current epoch, and return it (to pass to unpin). While a
+    thread has an epoch pinned, nothing retired after it pinned is freed. */
+    uint64_t pin() const {
+      Epoch_Slot& Slot = Thread_Slot();
+      while(true) {
+        /* If the epoch moved on before we were counted, unpin and try again
+        (otherwise we might be counted against an epoch that's been passed). */
+        uint64_t Epoch = Global_Epoch.load();
+        Slot.Pinned[Epoch % 2].fetch_add(1);
+
+        /* The fence orders our pin before everything we read while pinned
+        (see retire). */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(Global_Epoch.load() == Epoch) { return Epoch; }
+        Slot.Pinned[Epoch % 2].fetch_sub(1);
+      } // while(true) {
+    } // uint64_t pin() const {
+
+    void unpin(uint64_t Epoch) const { Thread_Slot().Pinned[Epoch % 2].fetch_sub(1); }
+
+    /* Retire an object (allocated with new) that no reader can reach any more
+    (though readers may still be looking at it). It is deleted once every
+    reader that could have seen it has unpinned. */
+    template<typename T>
+    void retire(T* Object) {
+      /* The fence (with the one in pin) means that either a reader pinned
+      after this fence can't see Object, or we read an epoch at least as new
+      as the reader's, so Object isn't freed until that reader is done. */
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      Retired_Object* Entry = new Retired_Object;
+      Entry->Object = Object;
+      Entry->Delete = &Delete_Object<T>;
+      Entry->Epoch = Global_Epoch.load();
+
+      /* Count the object before pushing it, so that whoever collects it never
+      takes the count below zero. */
+      Epoch_Slot& Slot = Thread_Slot();
+      unsigned N_Retired = Slot.N_Retired.fetch_add(1, std::memory_order_relaxed) + 1;
+      Push(Slot, Entry, Entry);
+      if(N_Retired >= Slot.Collect_At.load(std::memory_order_relaxed)) { Collect(Slot, Try_Advance()); }
+    } // void retire(T* Object) {
+
+    /* Number of retired objects that haven't been freed yet. This isn't exact
+    if other threads are retiring or collecting. */
+    unsigned retired_count() const {
+      unsigned N = 0;
+      for(unsigned i = 0; i < N_Slots; i++) { N += Slots[i].N_Retired.load(std::memory_order_relaxed); }
+      return N;
+    } // unsigned retired_count() const {
+
+    /* Try to free every slot's retired objects now (rather than waiting for
+    more of them to build up). Objects retired recently need a few calls. */
+    void collect() {
+      uint64_t Epoch = Try_Advance();
+      for(unsigned i = 0; i < N_Slots; i++) { Collect(Slots[i], Epoch); }
+    } // void collect() {
+
+  private:
+    template<typename T>
+    static void Delete_Object(void* Object) { delete static_cast<T*>(Object); }
+}; // class Epoch_Domain {
+
+
+
+// Pins a domain's epoch for as long as the guard exists.
+class Epoch_Guard {
+  private:
+    const Epoch_Domain& Domain;
+    uint64_t Epoch;
+
+    Epoch_Guard(const Epoch_Guard &) = delete;
+    Epoch_Guard& operator=(const Epoch_Guard &) = delete;
+
+  public:
+    explicit Epoch_Guard(const Epoch_Domain& Domain) : Domain(Domain), Epoch(Domain.pin()) {}
+    ~Epoch_Guard() { Domain.unpin(Epoch); }
+}; // class Epoch_Guard {
+
+
+
+/* A node in a chain that lock-free readers walk. A node's item never changes
+once the node is linked in (updates link in a new node instead), so readers
+can read it without locking. Next is atomic: writers publish with release
+stores and readers follow it with acquire loads. */
+template<typename K, typename V>
+struct Atomic_Item_Node {
+  ::Item<K, V> Item;
+  size_t Hash;                             // The key's hash
+  std::atomic<Atomic_Item_Node*> Next;
+
+  template<typename Key_Arg, typename... Args>
+  Atomic_Item_Node(size_t Hash, Key_Arg&& key, Args&&... args)
+    : Item(std::forward<Key_Arg>(key), std::forward<Args>(args)...), Hash(Hash), Next(NULL) {}
+}; // struct Atomic_Item_Node {
+
+
+
+/* A chained hash table whose lookups take no locks at all. This is for read
+mostly workloads, where even the stripe locks of Striped_Hash_Table (which
+readers write to) are too expensive.
+
+  - Readers pin an epoch (see Epoch_Domain), then walk the key's chain with
+    acquire loads. They never write to anything shared except their epoch
+    slot's pin count.
+  - Writers lock the stripe of the key's bucket (stripes are buckets modulo
+    N_Stripes), then link in a new node with a release store. Updating an
+    item links in a copy of its node with the new value in its place. Nodes
+    that are unlinked (by removes and updates) are retired to the epoch
+    domain rather than deleted, so readers that are still looking at them
+    are safe.
+  - Growing is cooperative (as in Java's ConcurrentHashMap). The writer that
+    finds the table too full makes a new bucket array, and from then on every
+    writer, before its own update, claims the next Migrate_Chunk buckets of
+    the old array that nobody has claimed and migrates them: it copies their
+    chains into the new array and leaves a forwarding marker in each one.
+    Readers and writers that reach a marker go on to the new array. Whoever
+    migrates the last bucket publishes the new array and retires the old one
+    (with its nodes). So the copying is spread over every writer, nobody
+    copies more than Migrate_Chunk buckets at a time, and nobody waits for a
+    whole migration.
+  - Each bucket array has its own stripe locks. Migrating a bucket holds its
+    stripe lock in the old array while it locks stripes in the new array,
+    but nothing ever locks a stripe in an older array while holding one in a
+    newer array, so this can't deadlock.
+
+Since an item is never changed once it's in the table, lookups copy values
+out, and updates (modify, upsert, compute) apply their function to a copy of
+the value. So V has to be copy constructible. Functions passed to updates are
+called while holding a stripe lock, and must not use the table. */
+template <typename K, typename V,
+          typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>,
+          typename Growth = Modulo_Growth>
+class Lock_Free_Read_Hash_Table {
+  private:
+    typedef Atomic_Item_Node<K, V> Node;
+    typedef std::unique_lock<std::mutex> Stripe_Lock;
+
+    // A writer lock stripe (cache line aligned, see Striped_Hash_Table).
+    struct alignas(64) Stripe {
+      std::mutex Lock;
+    }; // struct alignas(64) Stripe {
+
+    /* A bucket array. Each bucket is the first node of its chain, or the
+    forwarding marker (see Forwarded) once it has been migrated to Next. */
+    struct Bucket_Array {
+      unsigned N_Buckets;
+      Growth Policy;
+      std::atomic<Node*>* Buckets;
+      Node** Moved;                                  // The old chains of migrated buckets
+      Aligned_Array<Stripe> Stripes;                 // Bucket i's stripe is i modulo the stripe count
+
+      std::atomic<Bucket_Array*> Next;               // The array we're migrating to, if any
+      std::atomic<unsigned> Migrate_Index;           // The first bucket nobody has claimed
+      std::atomic<unsigned> N_Migrated;
+
+      Bucket_Array(unsigned N_Buckets, unsigned N_Stripes)
+          : N_Buckets(N_Buckets), Policy(N_Buckets), Stripes(N_Stripes), Next(NULL), Migrate_Index(0), N_Migrated(0) {
+        Buckets = new std::atomic<Node*>[N_Buckets];
+        try { Moved = new Node*[N_Buckets]; }
+        catch(...) {
+          delete [] Buckets;
+          throw;
+        } // catch(...) {
+        for(unsigned i = 0; i < N_Buckets; i++) { Buckets[i].store(NULL, std::memory_order_relaxed); }
+      } // Bucket_Array(unsigned N_Buckets, unsigned N_Stripes) ...
+
+      // The array owns its nodes (including the old chains of migrated buckets).
+      ~Bucket_Array() {
+        for(unsigned i = 0; i < N_Buckets; i++) {
+          Node* First = Buckets[i].load(std::memory_order_relaxed);
+          Delete_Chain((First == Forwarded()) ? Moved[i] : First);
+        } // for(unsigned i = 0; i < N_Buckets; i++) {
+        delete [] Moved;
+        delete [] Buckets;
+      } // ~Bucket_Array() {
+
+      std::mutex& Lock(unsigned i) const { return Stripes[i & (Stripes.size() - 1)].Lock; }
+    }; // struct Bucket_Array {
+
+    // Writers help migrate this many buckets at a time.
+    static const unsigned Migrate_Chunk = 64;
+
+    Hash Hasher;
+    KeyEqual Key_Equal;
+    float Max_Load_Factor;
+
+    std::atomic<Bucket_Array*> Array;      // The current bucket array
+    std::atomic<unsigned> N_Items;
+    unsigned N_Stripes;                    // Per bucket array; a power of two
+    std::atomic<bool> Growing;             // Whether a migration has been started (and not finished)
+    mutable Epoch_Domain Epochs;
+
+    Lock_Free_Read_Hash_Table(const Lock_Free_Read_Hash_Table &) = delete;
+    Lock_Free_Read_Hash_Table& operator=(const Lock_Free_Read_Hash_Table &) = delete;
+
+
+    /* Migrated buckets hold this marker instead of a chain. It's never
+    dereferenced, just compared against. */
+    static Node* Forwarded() {
+      alignas(Node) static char Marker;
+      return reinterpret_cast<Node*>(&Marker);
+    } // static Node* Forwarded() {
+
+    static void Delete_Chain(Node* First) {
+      Node* Next;
+      for(Node* N = First; N != NULL; N = Next) {
+        Next = N->Next.load(std::memory_order_relaxed);
+        delete N;
+      } // for(Node* N = First; N != NULL; N = Next) {
+    } // static void Delete_Chain(Node* First) {
+
+    /* The node with the specified key (whose hash is Key_Hash) in the chain
+    that starts at First, or NULL. Readers call this (with acquire loads), and
+    so do writers holding the chain's stripe lock. */
+    Node* Find_Node(Node* First, const K& key, size_t Key_Hash) const {
+      for(Node* N = First; N != NULL; N = N->Next.load(std::memory_order_acquire)) {
+        if(N->Hash == Key_Hash && Key_Equal(N->Item.key, key) == true) { return N; }
+      } // for(Node* N = First; N != NULL; N = N->Next.load(std::memory_order_acquire)) {
+      return NULL;
+    } // Node* Find_Node(Node* First, const K& key, size_t Key_Hash) const {
+
+    Node* Find_Node(const std::atomic<Node*>& Bucket, const K& key, size_t Key_Hash) const {
+      return Find_Node(Bucket.load(std::memory_order_acquire), key, Key_Hash);
+    } // Node* Find_Node(const std::atomic<Node*>& Bucket, const K& key, size_t Key_Hash) const {
+
+    /* The first node of the chain that the key's item would be in, for
+    readers: the chain of its bucket in the current array, or, if that bucket
+    has been migrated, in the array it was migrated to. The caller must have
+    an epoch pinned. */
+    Node* First_Node(size_t Key_Hash) const {
+      const Bucket_Array* A = Array.load(std::memory_order_acquire);
+      while(true) {
+        Node* First = A->Buckets[A->Policy.index(Key_Hash)].load(std::memory_order_acquire);
+        if(First != Forwarded()) { return First; }
+        A = A->Next.load(std::memory_order_acquire);
+      } // while(true) {
+    } // Node* First_Node(size_t Key_Hash) const {
+
+    /* The link (bucket, or previous node's Next) that points at node N, in
+    bucket Bucket. The caller must hold the bucket's stripe lock. */
+    static std::atomic<Node*>& Link_To(std::atomic<Node*>& Bucket, Node* N) {
+      std::atomic<Node*>* Link = &Bucket;
+      while(Link->load(std::memory_order_relaxed) != N) { Link = &Link->load(std::memory_order_relaxed)->Next; }
+      return *Link;
+    } // static std::atomic<Node*>& Link_To(std::atomic<Node*>& Bucket, Node* N) {
+
+
+    /* Help with the current migration (if there is one), then lock the
+    stripe of the key's bucket, and set A and i to the array that the key's
+    chain is in and its bucket in it. A bucket is only migrated by someone
+    holding its stripe lock, so the chain stays in A until we unlock. The
+    caller must have an epoch pinned (so that the arrays aren't freed while
+    we look at them). */
+    Stripe_Lock Lock_Bucket(size_t Key_Hash, Bucket_Array*& A, unsigned& i) {
+      A = Array.load(std::memory_order_acquire);
+      Help_Migrate(A);
+
+      while(true) {
+        i = A->Policy.index(Key_Hash);
+        Stripe_Lock Lock(A->Lock(i));
+        if(A->Buckets[i].load(std::memory_order_relaxed) != Forwarded()) { return Lock; }
+        A = A->Next.load(std::memory_order_acquire);
+      } // while(true) {
+    } // Stripe_Lock Lock_Bucket(size_t Key_Hash, Bucket_Array*& A, unsigned& i) {
+
+
+    /* Replace node Old (in bucket Bucket) with node New, or just unlink Old if
+    New is NULL, and retire Old. The caller must hold the bucket's stripe
+    lock. */
+    void Replace(std::atomic<Node*>& Bucket, Node* Old, Node* New) {
+      Node* After = Old->Next.load(std::memory_order_relaxed);
+      std::atomic<Node*>& Link = Link_To(Bucket, Old);
+
+      if(New != NULL) {
+        New->Next.store(After, std::memory_order_relaxed);
+        Link.store(New, std::memory_order_release);
+      } // if(New != NULL) {
+      else { Link.store(After, std::memory_order_release); }
+
+      Epochs.retire(Old);
+    } // void Replace(std::atomic<Node*>& Bucket, Node* Old, Node* New) {
+
+
+    /* Link a new node in at the start of bucket Bucket (and count it). The
+    caller must hold the bucket's stripe lock. */
+    void Link_First(std::atomic<Node*>& Bucket, Node* New) {
+      New->Next.store(Bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      Bucket.store(New, std::memory_order_release);
+      N_Items.fetch_add(1, std::memory_order_relaxed);
+    } // void Link_First(std::atomic<Node*>& Bucket, Node* New) {
+
+    // Link_First a new node made from key and args.
+    template<typename... Args>
+    void Add(std::atomic<Node*>& Bucket, size_t Key_Hash, const K& key, Args&&... args) {
+      Link_First(Bucket, new Node(Key_Hash, key, std::forward<Args>(args)...));
+    } // void Add(std::atomic<Node*>& Bucket, size_t Key_Hash, const K& key, Args&&... args) {
+
+
+    /* Copy bucket i of array A (which is being migrated) into A's next array,
+    then leave a forwarding marker in it. Copying happens first, so if it
+    throws, the bucket is left as it was. */
+    void Migrate_Bucket(Bucket_Array* A, unsigned i) {
+      Bucket_Array* To = A->Next.load(std::memory_order_acquire);
+      Stripe_Lock Lock(A->Lock(i));
+      Node* First = A->Buckets[i].load(std::memory_order_relaxed);
+
+      Node* Copies = NULL;
+      try {
+        for(Node* N = First; N != NULL; N = N->Next.load(std::memory_order_relaxed)) {
+          Node* Copy = new Node(N->Hash, N->Item.key, N->Item.value);
+          Copy->Next.store(Copies, std::memory_order_relaxed);
+          Copies = Copy;
+        } // for(Node* N = First; N != NULL; N = N->Next.load(std::memory_order_relaxed)) {
+      } // try {
+      catch(...) {
+        Delete_Chain(Copies);
+        throw;
+      } // catch(...) {
+
+      // Other migrators (and writers) may be using the destination buckets.
+      while(Copies != NULL) {
+        Node* Copy = Copies;
+        Copies = Copy->Next.load(std::memory_order_relaxed);
+
+        unsigned j = To->Policy.index(Copy->Hash);
+        Stripe_Lock To_Lock(To->Lock(j));
+        Copy->Next.store(To->Buckets[j].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        To->Buckets[j].store(Copy, std::memory_order_release);
+      } // while(Copies != NULL) {
+
+      /* Readers that already have the old chain can keep walking it. It's
+      freed with A. */
+      A->Moved[i] = First;
+      A->Buckets[i].store(Forwarded(), std::memory_order_release);
+    } // void Migrate_Bucket(Bucket_Array* A, unsigned i) {
+
+    /* If array A is being migrated, claim the next Migrate_Chunk buckets that
+    nobody has claimed, and migrate them. Whoever migrates the last bucket
+    publishes the new array and retires A.
+
+    If migrating a bucket throws, the rest of its chunk is never migrated, so
+    that migration never finishes: the table keeps working (with some
+    buckets in each array) but stops growing. */
+    void Help_Migrate(Bucket_Array* A) {
+      if(A->Next.load(std::memory_order_acquire) == NULL) { return; }
+      if(A->Migrate_Index.load(std::memory_order_relaxed) >= A->N_Buckets) { return; }
+
+      unsigned Start = A->Migrate_Index.fetch_add(Migrate_Chunk, std::memory_order_relaxed);
+      if(Start >= A->N_Buckets) { return; }
+      unsigned End = (A->N_Buckets - Start > Migrate_Chunk) ? Start + Migrate_Chunk : A->N_Buckets;
+      for(unsigned i = Start; i < End; i++) { Migrate_Bucket(A, i); }
+
+      if(A->N_Migrated.fetch_add(End - Start, std::memory_order_acq_rel) + (End - Start) == A->N_Buckets) {
+        Array.store(A->Next.load(std::memory_order_relaxed), std::memory_order_release);
+        Growing.store(false, std::memory_order_release);
+        Epochs.retire(A);
+      } // if(A->N_Migrated.fetch_add(End - Start, std::memory_order_acq_rel) + (End - Start) == A->N_Buckets) {
+    } // void Help_Migrate(Bucket_Array* A) {
+
+    /* If the load factor exceeds the max load factor then start growing the
+    table (roughly doubling the number of buckets, as the growth policy
+    decides), unless that's already under way. Either way, we then help
+    migrate. */
+    void Grow_If_Needed() {
+      Bucket_Array* A = Array.load(std::memory_order_acquire);
+      if(N_Items.load(std::memory_order_relaxed) <= Max_Load_Factor*A->N_Buckets) { return; }
+
+      /* Only the thread that sets Growing starts a migration. Growing is
+      cleared after the new array is published, so if A is still current,
+      nobody has started migrating it. */
+      if(A->Next.load(std::memory_order_acquire) == NULL && Growing.exchange(true, std::memory_order_acq_rel) == false) {
+        if(Array.load(std::memory_order_acquire) != A) { Growing.store(false, std::memory_order_release); }
+        else {
+          unsigned New_N_Buckets = Growth::size(Growth::grow(A->N_Buckets));
+          while(N_Items.load(std::memory_order_relaxed) > Max_Load_Factor*New_N_Buckets) {
+            New_N_Buckets = Growth::size(Growth::grow(New_N_Buckets));
+          } // while(N_Items.load(std::memory_order_relaxed) > Max_Load_Factor*New_N_Buckets) {
+
+          try { A->Next.store(new Bucket_Array(New_N_Buckets, N_Stripes), std::memory_order_release); }
+          catch(...) {
+            Growing.store(false, std::memory_order_release);
+            throw;
+          } // catch(...) {
+        } // else
+      } // if(A->Next.load(std::memory_order_acquire) == NULL && ...
+
+      Help_Migrate(A);
+    } // void Grow_If_Needed() {
+
+  public:
+    /* Constructor, destructor. N_Stripes (the number of writer locks) is
+    rounded up to a power of two. */
+    Lock_Free_Read_Hash_Table(unsigned N_Buckets = 11, float Max_Load_Factor = 1.0, unsigned N_Stripes = 64,
+                              const Hash& Hasher = Hash(), const KeyEqual& Key_Equal = KeyEqual())
+        : Hasher(Hasher), Key_Equal(Key_Equal), Max_Load_Factor((Max_Load_Factor <= 0) ? 1.0f : Max_Load_Factor),
+          N_Items(0), N_Stripes(Power_Of_Two_At_Least(N_Stripes)), Growing(false) {
+      Array.store(new Bucket_Array(Growth::size(N_Buckets), Lock_Free_Read_Hash_Table::N_Stripes));
+    } // Lock_Free_Read_Hash_Table(unsigned N_Buckets = 11, float Max_Load_Factor = 1.0, unsigned N_Stripes = 64, ...
+
+    /* Free the current array, and the one it's being migrated to (if any).
+    The domain's destructor frees everything that's been retired. */
+    ~Lock_Free_Read_Hash_Table() {
+      Bucket_Array* A = Array.load();
+      delete A->Next.load();
+      delete A;
+    } // ~Lock_Free_Read_Hash_Table() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned size() const { return N_Items.load(std::memory_order_relaxed); }
+    float load_factor() const { return ((float)size())/bucket_count(); }
+    float max_load_factor() const { return Max_Load_Factor; }
+    unsigned stripe_count() const { return N_Stripes; }
+
+    // The number of buckets (in the array that's being migrated to, if any).
+    unsigned bucket_count() const {
+      const Bucket_Array* A = Array.load(std::memory_order_acquire);
+      const Bucket_Array* Next = A->Next.load(std::memory_order_acquire);
+      return (Next == NULL) ? A->N_Buckets : Next->N_Buckets;
+    } // unsigned bucket_count() const {
+
+    // Whether the table is part way through growing.
+    bool migrating() const { return Array.load(std::memory_order_acquire)->Next.load(std::memory_order_acquire) != NULL; }
+
+    /* The table's epoch domain (where unlinked nodes wait to be freed). This
+    is mostly useful for checking that retired nodes do get freed. */
+    Epoch_Domain& epochs() const { return Epochs; }
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Updates
+
+    /* Insert an item into the table. If an item with the specified key is
+    already in the table, its value is updated. */
+    void insert(const K& key, const V& value) { insert_or_assign(key, value); }
+
+    /* Set the value of the item with the specified key to value (adding an
+    item if there isn't one). Returns true if a new item was added. */
+    bool insert_or_assign(const K& key, const V& value) {
+      size_t Key_Hash = Hasher(key);
+      Epoch_Guard Guard(Epochs);
+      {
+        Bucket_Array* A;
+        unsigned i;
+        Stripe_Lock Lock = Lock_Bucket(Key_Hash, A, i);
+
+        Node* Old = Find_Node(A->Buckets[i], key, Key_Hash);
+        if(Old != NULL) {
+          Replace(A->Buckets[i], Old, new Node(Key_Hash, key, value));
+          return false;
+        } // if(Old != NULL) {
+
+        Add(A->Buckets[i], Key_Hash, key, value);
+      } // {
+
+      Grow_If_Needed();
+      return true;
+    } // bool insert_or_assign(const K& key, const V& value) {
+
+    /* Add an item whose value is constructed from args, unless an item with
+    the specified key is already in the table. Returns true if a new item was
+    added. */
+    template<typename... Args>
+    bool emplace(const K& key, Args&&... args) {
+      size_t Key_Hash = Hasher(key);
+      Epoch_Guard Guard(Epochs);
+      {
+        Bucket_Array* A;
+        unsigned i;
+        Stripe_Lock Lock = Lock_Bucket(Key_Hash, A, i);
+        if(Find_Node(A->Buckets[i], key, Key_Hash) != NULL) { return false; }
+
+        Add(A->Buckets[i], Key_Hash, key, std::forward<Args>(args)...);
+      } // {
+
+      Grow_If_Needed();
+      return true;
+    } // bool emplace(const K& key, Args&&... args) {
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      size_t Key_Hash = Hasher(key);
+      Epoch_Guard Guard(Epochs);
+      Bucket_Array* A;
+      unsigned i;
+      Stripe_Lock Lock = Lock_Bucket(Key_Hash, A, i);
+
+      Node* Old = Find_Node(A->Buckets[i], key, Key_Hash);
+      if(Old == NULL) { return; }
+
+      Replace(A->Buckets[i], Old, NULL);
+      N_Items.fetch_sub(1, std::memory_order_relaxed);
+    } // void remove(const K& key) {
+
+    /* Update the value of the item with the specified key by calling Fn(Value)
+    on a copy of its value, which then replaces the item. Returns false (without
+    calling Fn) if there is no item with the specified key. */
+    template<typename Function>
+    bool modify(const K& key, Function Fn) {
+      size_t Key_Hash = Hasher(key);
+      Epoch_Guard Guard(Epochs);
+      Bucket_Array* A;
+      unsigned i;
+      Stripe_Lock Lock = Lock_Bucket(Key_Hash, A, i);
+
+      Node* Old = Find_Node(A->Buckets[i], key, Key_Hash);
+      if(Old == NULL) { return false; }
+
+      std::unique_ptr<Node> New(new Node(Key_Hash, key, Old->Item.value));
+      Fn(New->Item.value);
+      Replace(A->Buckets[i], Old, New.release());
+      return true;
+    } // bool modify(const K& key, Function Fn) {
+
+    /* If no item has the specified key, add one with value init. Otherwise,
+    replace the item with one whose value is a copy of the old value that's
+    been merged with Merge(Value, init). Returns true if a new item was
+    added. */
+    template<typename Function>
+    bool upsert(const K& key, const V& init, Function Merge) {
+      size_t Key_Hash = Hasher(key);
+      Epoch_Guard Guard(Epochs);
+      {
+        Bucket_Array* A;
+        unsigned i;
+        Stripe_Lock Lock = Lock_Bucket(Key_Hash, A, i);
+
+        Node* Old = Find_Node(A->Buckets[i], key, Key_Hash);
+        if(Old != NULL) {
+          std::unique_ptr<Node> New(new Node(Key_Hash, key, Old->Item.value));
+          Merge(New->Item.value, init);
+          Replace(A->Buckets[i], Old, New.release());
+          return false;
+        } // if(Old != NULL) {
+
+        Add(A->Buckets[i], Key_Hash, key, init);
+      } // {
+
+      Grow_If_Needed();
+      return true;
+    } // bool upsert(const K& key, const V& init, Function Merge) {
+
+    /* Call Fn(Value) on a copy of the value of the item with the specified key,
+    which then replaces the item. If there is no such item, one is added
+    with a value-initialized value first. Returns true if a new item was
+    added. */
+    template<typename Function>
+    bool compute(const K& key, Function Fn) {
+      size_t Key_Hash = Hasher(key);
+      Epoch_Guard Guard(Epochs);
+      {
+        Bucket_Array* A;
+        unsigned i;
+        Stripe_Lock Lock = Lock_Bucket(Key_Hash, A, i);
+
+        Node* Old = Find_Node(A->Buckets[i], key, Key_Hash);
+        std::unique_ptr<Node> New((Old == NULL) ? new Node(Key_Hash, key) : new Node(Key_Hash, key, Old->Item.value));
+        Fn(New->Item.value);
+
+        if(Old != NULL) {
+          Replace(A->Buckets[i], Old, New.release());
+          return false;
+        } // if(Old != NULL) {
+
+        Link_First(A->Buckets[i], New.release());
+      } // {
+
+      Grow_If_Needed();
+      return true;
+    } // bool compute(const K& key, Function Fn) {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Lookups (none of these lock)
+
+    /* If an item has the specified key, copy its value into Value and return
+    true. Otherwise, return false (and leave Value alone). */
+    bool find(const K& key, V& Value) const {
+      size_t Key_Hash = Hasher(key);
+      Epoch_Guard Guard(Epochs);
+
+      const Node* N = Find_Node(First_Node(Key_Hash), key, Key_Hash);
+      if(N == NULL) { return false; }
+      Value = N->Item.value;
+      return true;
+    } // bool find(const K& key, V& Value) const {
+
+    /* Returns (a copy of) the value of the item with the specified key. Throws
+    an exception if no item with the specified key can be found. */
+    V search(const K& key) const {
+      size_t Key_Hash = Hasher(key);
+      Epoch_Guard Guard(Epochs);
+
+      const Node* N = Find_Node(First_Node(Key_Hash), key, Key_Hash);
+      if(N == NULL) {
+        char Error_Message_Buffer[500];
+        snprintf(Error_Message_Buffer, sizeof(Error_Message_Buffer),
+                 "Invalid Key Error: This hash table does not have an entry with key %s\n",
+                 Describe_Key(key).c_str());
+        throw Invalid_Key(Error_Message_Buffer);
+      } // if(N == NULL) {
+      return N->Item.value;
+    } // V search(const K& key) const {
+
+    // Returns true if the table has an item with the specified key.
+    bool contains(const K& key) const {
+      size_t Key_Hash = Hasher(key);
+      Epoch_Guard Guard(Epochs);
+      return Find_Node(First_Node(Key_Hash), key, Key_Hash) != NULL;
+    } // bool contains(const K& key) const {
+
+    /* Returns the value of the item with the specified key, or Default if
+    there is no such item. */
+    V get_or(const K& key, const V& Default) const {
+      V Value(Default);
+      find(key, Value);
+      return Value;
+    } // V get_or(const K& key, const V& Default) const {
+
+
+    /* Printing method. This isn't a snapshot if other threads are changing
+    the table. */
+    friend std::ostream & operator<<(std::ostream & os, const Lock_Free_Read_Hash_Table & Table) {
+      Epoch_Guard Guard(Table.Epochs);
+      const Bucket_Array* A = Table.Array.load(std::memory_order_acquire);
+      const Bucket_Array* Next = A->Next.load(std::memory_order_acquire);
+
+      // If we're partway through a migration, print the new buckets, then the old ones that haven't moved yet.
+      Print_Buckets(os, (Next == NULL) ? A : Next, "Bucket ");
+      if(Next != NULL) { Print_Buckets(os, A, "Old Bucket "); }
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Lock_Free_Read_Hash_Table & Table) {
+
+  private:
+    // Print every bucket of A that hasn't been migrated.
+    static void Print_Buckets(std::ostream & os, const Bucket_Array* A, const char* Label) {
+      for(unsigned i = 0; i < A->N_Buckets; i++) {
+        const Node* First = A->Buckets[i].load(std::memory_order_acquire);
+        if(First == Forwarded()) { continue; }
+
+        os << Label << i << ": ";
+        for(const Node* N = First; N != NULL; N = N->Next.load(std::memory_order_acquire)) {
+          os << "{" << N->Item.key << " : " << N->Item.value << "}";
+          if(N->Next.load(std::memory_order_acquire) != NULL) { os << " -> "; }
+        } // for(const Node* N = First; N != NULL; N = N->Next.load(std::memory_order_acquire)) {
+        os << std::endl;
+      } // for(unsigned i = 0; i < A->N_Buckets; i++) {
+    } // static void Print_Buckets(std::ostream & os, const Bucket_Array* A, const char* Label) {
+}; // class Lock_Free_Read_Hash_Table {
+
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Growth>
+const unsigned Lock_Free_Read_Hash_Table<K, V, Hash, KeyEqual, Growth>::Migrate_Chunk;
+
+
+
+// Reverse the order of x's bits (bit 0 becomes bit 63, and so on).
+inline uint64_t Reverse_Bits(uint64_t x) {
+  x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+  x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+  x = ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+  x = ((x >> 8) & 0x00FF00FF00FF00FFull) | ((x & 0x00FF00FF00FF00FFull) << 8);
+  x = ((x >> 16) & 0x0000FFFF0000FFFFull) | ((x & 0x0000FFFF0000FFFFull) << 16);
+  return (x >> 32) | (x << 32);
+} // inline uint64_t Reverse_Bits(uint64_t x) {
+
+
+
+/* A hash table that never locks, for updates or lookups, based on Shalev and
+Shavit's split-ordered lists. This is for write heavy workloads, where the
+stripe locks of Striped_Hash_Table and Lock_Free_Read_Hash_Table are
+contended.
+
+  - Every item is in one lock-free sorted linked list (a Harris-Michael list:
+    a node is removed by first setting the low bit of its Next pointer, which
+    marks it, and then unlinking it; anyone who walks past a marked node
+    helps by unlinking it).
+  - There are 2^n buckets, and a key's bucket is the low n bits of its
+    (mixed) hash. The list is sorted by hash with the bits reversed, so each
+    bucket's items are next to each other in the list, and doubling the
+    bucket count splits each bucket's run of items in two, in place. Growing
+    just doubles the bucket count; nothing is moved or copied.
+  - Each bucket's run starts with a dummy node (which isn't an item). The
+    bucket directory points at the dummy nodes, so operations can skip
+    straight to their bucket's part of the list. A bucket's dummy node is
+    linked in the first time an update uses the bucket (after the dummy of
+    its parent, the bucket it was split from). Lookups never link in dummy
+    nodes: if a key's bucket doesn't have one yet, they start from the
+    closest ancestor bucket that does.
+  - The directory is a fixed list of segments, which are allocated when they
+    are first needed. Segment 0 holds the first First_Segment_Size buckets,
+    and each later segment holds as many buckets as all the ones before it,
+    so the directory grows without copying, too.
+
+A node's value can be replaced at any time, so nodes hold their value by
+pointer: updates make a new value and swap it in. Old values and unlinked
+nodes are retired to an epoch domain (see Epoch_Domain, whose retire doesn't
+lock either), since readers may still be looking at them. Lookups copy values
+out. Read-modify-write updates (modify, upsert, compute) call their function
+on a copy of the value and then swap it in if the value hasn't changed in the
+meantime (and otherwise try again, with the new value). So these functions
+can be called more than once per update, and must not have side effects or
+use the table. */
+template <typename K, typename V,
+          typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K> >
+class Split_Ordered_Hash_Table {
+  private:
+    /* A node in the list. Dummy nodes are just Nodes; items are Key_Nodes. The
+    low bit of Next is set once the node has been removed (so that nothing
+    can be linked in after it). */
+    struct Node {
+      std::atomic<uintptr_t> Next;
+      uint64_t Order;                      // Where the node goes: odd for items, even for dummies
+
+      explicit Node(uint64_t Order) : Next(0), Order(Order) {}
+    }; // struct Node {
+
+    struct Key_Node : public Node {
+      K key;
+      std::atomic<V*> Value;
+
+      template<typename... Args>
+      Key_Node(uint64_t Order, const K& key, Args&&... args)
+        : Node(Order), key(key), Value(new V(std::forward<Args>(args)...)) {}
+      ~Key_Node() { delete Value.load(std::memory_order_relaxed); }
+    }; // struct Key_Node : public Node {
+
+    static const unsigned First_Segment_Size = 64;
+    static const unsigned Max_Segments = 26;                                       // Enough for 2^31 buckets
+    static const unsigned Max_Buckets = First_Segment_Size << (Max_Segments - 1);
+
+    Hash Hasher;
+    KeyEqual Key_Equal;
+    float Max_Load_Factor;
+
+    std::atomic<std::atomic<Node*>*> Segments[Max_Segments];
+    std::atomic<unsigned> N_Buckets;       // A power of two
+    std::atomic<unsigned> N_Items;
+    mutable Epoch_Domain Epochs;
+
+    Split_Ordered_Hash_Table(const Split_Ordered_Hash_Table &) = delete;
+    Split_Ordered_Hash_Table& operator=(const Split_Ordered_Hash_Table &) = delete;
+
+
+    static Node* Pointer(uintptr_t Link) { return reinterpret_cast<Node*>(Link & ~(uintptr_t)1); }
+    static bool Marked(uintptr_t Link) { return (Link & 1) != 0; }
+
+    static void Delete_Node(Node* N) {
+      if((N->Order & 1) == 1) { delete static_cast<Key_Node*>(N); }
+      else { delete N; }
+    } // static void Delete_Node(Node* N) {
+
+    // Where items and dummy nodes go in the list.
+    static uint64_t Item_Order(size_t Key_Hash) { return Reverse_Bits(Key_Hash) | 1; }
+    static uint64_t Dummy_Order(unsigned i) { return Reverse_Bits(i); }
+
+    // The bucket that bucket i (> 0) was split from: i without its highest bit.
+    static unsigned Parent(unsigned i) { return i & ~(1u << Highest_Bit(i)); }
+
+    // The segment that bucket i is in, and the first bucket of segment s.
+    static unsigned Segment_Of(unsigned i) {
+      return (i < First_Segment_Size) ? 0 : Highest_Bit(i) - Log2(First_Segment_Size) + 1;
+    } // static unsigned Segment_Of(unsigned i) {
+    static unsigned Segment_Start(unsigned s) { return (s == 0) ? 0 : First_Segment_Size << (s - 1); }
+    static unsigned Segment_Size(unsigned s) { return (s == 0) ? First_Segment_Size : First_Segment_Size << (s - 1); }
+
+    size_t Hash_Of(const K& key) const { return (size_t)Mix_Hash(Hasher(key)); }
+    unsigned Bucket_Of(size_t Key_Hash) const {
+      return (unsigned)(Key_Hash & (N_Buckets.load(std::memory_order_acquire) - 1));
+    } // unsigned Bucket_Of(size_t Key_Hash) const {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Bucket directory
+
+    // Bucket i's directory entry, allocating its segment if it doesn't exist yet.
+    std::atomic<Node*>& Entry(unsigned i) {
+      unsigned s = Segment_Of(i);
+      std::atomic<Node*>* Segment = Segments[s].load(std::memory_order_acquire);
+      if(Segment == NULL) {
+        std::atomic<Node*>* New = new std::atomic<Node*>[Segment_Size(s)];
+        for(unsigned j = 0; j < Segment_Size(s); j++) { New[j].store(NULL, std::memory_order_relaxed); }
+
+        // If another thread allocated the segment first, use theirs.
+        if(Segments[s].compare_exchange_strong(Segment, New, std::memory_order_acq_rel, std::memory_order_acquire) == true) { Segment = New; }
+        else { delete [] New; }
+      } // if(Segment == NULL) {
+      return Segment[i - Segment_Start(s)];
+    } // std::atomic<Node*>& Entry(unsigned i) {
+
+    // Bucket i's dummy node, or NULL if it hasn't been linked in yet.
+    Node* Find_Dummy(unsigned i) const {
+      unsigned s = Segment_Of(i);
+      std::atomic<Node*>* Segment = Segments[s].load(std::memory_order_acquire);
+      return (Segment == NULL) ? NULL : Segment[i - Segment_Start(s)].load(std::memory_order_acquire);
+    } // Node* Find_Dummy(unsigned i) const {
+
+    /* Bucket i's dummy node, linking it in (and its parent's, and so on) if
+    it isn't there yet. */
+    Node* Dummy(unsigned i) {
+      std::atomic<Node*>& Slot = Entry(i);
+      Node* D = Slot.load(std::memory_order_acquire);
+      if(D != NULL) { return D; }
+
+      // Another thread may link in the same dummy first, in which case we use theirs.
+      std::unique_ptr<Node> New(new Node(Dummy_Order(i)));
+      D = Link(Dummy(Parent(i)), New.get(), NULL);
+      if(D == New.get()) { New.release(); }
+      Slot.store(D, std::memory_order_release);
+      return D;
+    } // Node* Dummy(unsigned i) {
+
+    /* Where lookups for an item with the specified hash start: the dummy node
+    of its bucket, or of the closest ancestor bucket that has one (which
+    comes before it in the list). Bucket 0 always has a dummy node. */
+    Node* Lookup_Start(size_t Key_Hash) const {
+      unsigned i = Bucket_Of(Key_Hash);
+      Node* D;
+      while((D = Find_Dummy(i)) == NULL) { i = Parent(i); }
+      return D;
+    } // Node* Lookup_Start(size_t Key_Hash) const {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // The list
+
+    /* Search the list, from dummy node Start, for the node with the specified
+    order and key (key is NULL when looking for a dummy node). Returns true
+    if we find it. Either way, Curr is set to where the search stopped (the
+    node we're looking for, the first node that comes after it, or NULL) and
+    Prev to the link that points at Curr. Marked nodes that we pass are
+    unlinked and retired. The caller must have an epoch pinned. */
+    bool Find(Node* Start, uint64_t Order, const K* key, std::atomic<uintptr_t>*& Prev, Node*& Curr) const {
+      while(true) {
+        Prev = &Start->Next;
+        Curr = Pointer(Prev->load(std::memory_order_acquire));
+        bool Restart = false;
+
+        while(Curr != NULL) {
+          uintptr_t Next = Curr->Next.load(std::memory_order_acquire);
+
+          /* Unlink Curr if it's been removed. If Prev has changed (its node
+          was removed, or something was linked in after it), start again. */
+          if(Marked(Next) == true) {
+            uintptr_t Expected = reinterpret_cast<uintptr_t>(Curr);
+            if(Prev->compare_exchange_strong(Expected, Next & ~(uintptr_t)1, std::memory_order_acq_rel, std::memory_order_acquire) == false) {
+              Restart = true;
+              break;
+            } // if(Prev->compare_exchange_strong(Expected, Next & ~(uintptr_t)1, ...
+            Epochs.retire(static_cast<Key_Node*>(Curr));
+            Curr = Pointer(Next);
+            continue;
+          } // if(Marked(Next) == true) {
+
+          if(Curr->Order > Order) { return false; }
+          if(Curr->Order == Order && (key == NULL || Key_Equal(static_cast<Key_Node*>(Curr)->key, *key) == true)) { return true; }
+          Prev = &Curr->Next;
+          Curr = Pointer(Next);
+        } // while(Curr != NULL) {
+
+        if(Restart == false) { return false; }
+      } // while(true) {
+    } // bool Find(Node* Start, uint64_t Order, const K* key, std::atomic<uintptr_t>*& Prev, Node*& Curr) const {
+
+    // The item with the specified key (searching from Start), or NULL.
+    Key_Node* Find_Item(Node* Start, const K& key, size_t Key_Hash) const {
+      std::atomic<uintptr_t>* Prev;
+      Node* Curr;
+      return (Find(Start, Item_Order(Key_Hash), &key, Prev, Curr) == true) ? static_cast<Key_Node*>(Curr) : NULL;
+    } // Key_Node* Find_Item(Node* Start, const K& key, size_t Key_Hash) const {
+
+    /* Link node New into the list (searching from Start), unless a node with
+    the same order (and key) is already there. Returns the node that's in the
+    list: New if we linked it in, or the node that was already there (in
+    which case New still belongs to the caller). */
+    Node* Link(Node* Start, Node* New, const K* key) {
+      std::atomic<uintptr_t>* Prev;
+      Node* Curr;
+      while(true) {
+        if(Find(Start, New->Order, key, Prev, Curr) == true) { return Curr; }
+
+        New->Next.store(reinterpret_cast<uintptr_t>(Curr), std::memory_order_relaxed);
+        uintptr_t Expected = reinterpret_cast<uintptr_t>(Curr);
+        if(Prev->compare_exchange_strong(Expected, reinterpret_cast<uintptr_t>(New), std::memory_order_release, std::memory_order_relaxed) == true) {
+          return New;
+        } // if(Prev->compare_exchange_strong(Expected, reinterpret_cast<uintptr_t>(New), ...
+      } // while(true) {
+    } // Node* Link(Node* Start, Node* New, const K* key) {
+
+    /* Link item New in (searching from Start), unless the table already has
+    an item with its key. Sets N to the item with New's key that's in the
+    table, and returns true if that's New (in which case New is released,
+    and the table grows if it needs to). */
+    bool Add(Node* Start, std::unique_ptr<Key_Node>& New, Key_Node*& N) {
+      N = static_cast<Key_Node*>(Link(Start, New.get(), &New->key));
+      if(N != New.get()) { return false; }
+      New.release();
+
+      // Double the bucket count if the load factor is now too high.
+      unsigned Count = N_Items.fetch_add(1, std::memory_order_relaxed) + 1;
+      unsigned Buckets = N_Buckets.load(std::memory_order_relaxed);
+      while(Count > Max_Load_Factor*Buckets && Buckets < Max_Buckets) {
+        if(N_Buckets.compare_exchange_weak(Buckets, 2*Buckets, std::memory_order_release, std::memory_order_relaxed) == true) { Buckets *= 2; }
+      } // while(Count > Max_Load_Factor*Buckets && Buckets < Max_Buckets) {
+      return true;
+    } // bool Add(Node* Start, std::unique_ptr<Key_Node>& New, Key_Node*& N) {
+
+    // Replace item N's value with Value (which the table takes ownership of).
+    void Assign(Key_Node* N, V* Value) {
+      Epochs.retire(N->Value.exchange(Value, std::memory_order_acq_rel));
+    } // void Assign(Key_Node* N, V* Value) {
+
+    /* Replace item N's value with a copy of it that Fn has been called on. If
+    someone else replaces the value first, we try again with theirs. */
+    template<typename Function>
+    void Update(Key_Node* N, Function& Fn) {
+      V* Old = N->Value.load(std::memory_order_acquire);
+      while(true) {
+        std::unique_ptr<V> New(new V(*Old));
+        Fn(*New);
+        if(N->Value.compare_exchange_weak(Old, New.get(), std::memory_order_acq_rel, std::memory_order_acquire) == true) {
+          New.release();
+          Epochs.retire(Old);
+          return;
+        } // if(N->Value.compare_exchange_weak(Old, New.get(), ...
+      } // while(true) {
+    } // void Update(Key_Node* N, Function& Fn) {
+
+  public:
+    /* Constructor, destructor. N_Buckets is rounded up to a power of two. */
+    Split_Ordered_Hash_Table(unsigned N_Buckets = 16, float Max_Load_Factor = 1.0,
+                             const Hash& Hasher = Hash(), const KeyEqual& Key_Equal = KeyEqual())
+        : Hasher(Hasher), Key_Equal(Key_Equal), Max_Load_Factor((Max_Load_Factor <= 0) ? 1.0f : Max_Load_Factor),
+          N_Buckets((N_Buckets > Max_Buckets) ? Max_Buckets : Power_Of_Two_At_Least(N_Buckets)), N_Items(0) {
+      for(unsigned s = 0; s < Max_Segments; s++) { Segments[s].store(NULL, std::memory_order_relaxed); }
+      Entry(0).store(new Node(Dummy_Order(0)), std::memory_order_relaxed);
+    } // Split_Ordered_Hash_Table(unsigned N_Buckets = 16, float Max_Load_Factor = 1.0, ...
+
+    /* Free every node that's still in the list (the epoch domain's destructor
+    frees the ones that were unlinked), then the directory. */
+    ~Split_Ordered_Hash_Table() {
+      Node* Next;
+      for(Node* N = Find_Dummy(0); N != NULL; N = Next) {
+        Next = Pointer(N->Next.load(std::memory_order_relaxed));
+        Delete_Node(N);
+      } // for(Node* N = Find_Dummy(0); N != NULL; N = Next) {
+
+      for(unsigned s = 0; s < Max_Segments; s++) { delete [] Segments[s].load(std::memory_order_relaxed); }
+    } // ~Split_Ordered_Hash_Table() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned size() const { return N_Items.load(std::memory_order_relaxed); }
+    unsigned bucket_count() const { return N_Buckets.load(std::memory_order_acquire); }
+    float load_factor() const { return ((float)size())/bucket_count(); }
+    float max_load_factor() const { return Max_Load_Factor; }
+
+    // The number of buckets whose dummy node has been linked in.
+    unsigned initialized_bucket_count() const {
+      unsigned Count = 0;
+      for(unsigned i = 0; i < bucket_count(); i++) {
+        if(Find_Dummy(i) != NULL) { Count++; }
+      } // for(unsigned i = 0; i < bucket_count(); i++) {
+      return Count;
+    } // unsigned initialized_bucket_count() const {
+
+    /* The table's epoch domain (where unlinked nodes and replaced values wait
+    to be freed). */
+    Epoch_Domain& epochs() const { return Epochs; }
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Updates (none of these lock)
+
+    /* Insert an item into the table. If an item with the specified key is
+    already in the table, its value is updated. */
+    void insert(const K& key, const V& value) { insert_or_assign(key, value); }
+
+    /* Set the value of the item with the specified key to value (adding an
+    item if there isn't one). Returns true if a new item was added. */
+    bool insert_or_assign(const K& key, const V& value) {
+      size_t Key_Hash = Hash_Of(key);
+      Epoch_Guard Guard(Epochs);
+      Node* Start = Dummy(Bucket_Of(Key_Hash));
+
+      Key_Node* N = Find_Item(Start, key, Key_Hash);
+      if(N == NULL) {
+        std::unique_ptr<Key_Node> New(new Key_Node(Item_Order(Key_Hash), key, value));
+        if(Add(Start, New, N) == true) { return true; }
+      } // if(N == NULL) {
+
+      Assign(N, new V(value));
+      return false;
+    } // bool insert_or_assign(const K& key, const V& value) {
+
+    /* Add an item whose value is constructed from args, unless an item with
+    the specified key is already in the table. Returns true if a new item was
+    added. */
+    template<typename... Args>
+    bool emplace(const K& key, Args&&... args) {
+      size_t Key_Hash = Hash_Of(key);
+      Epoch_Guard Guard(Epochs);
+      Node* Start = Dummy(Bucket_Of(Key_Hash));
+      if(Find_Item(Start, key, Key_Hash) != NULL) { return false; }
+
+      Key_Node* N;
+      std::unique_ptr<Key_Node> New(new Key_Node(Item_Order(Key_Hash), key, std::forward<Args>(args)...));
+      return Add(Start, New, N);
+    } // bool emplace(const K& key, Args&&... args) {
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      size_t Key_Hash = Hash_Of(key);
+      uint64_t Order = Item_Order(Key_Hash);
+      Epoch_Guard Guard(Epochs);
+      Node* Start = Dummy(Bucket_Of(Key_Hash));
+
+      std::atomic<uintptr_t>* Prev;
+      Node* Curr;
+      while(true) {
+        if(Find(Start, Order, &key, Prev, Curr) == false) { return; }
+
+        /* Mark the node. If someone else marked it first (or linked a node in
+        after it), search again. */
+        uintptr_t Next = Curr->Next.load(std::memory_order_acquire);
+        if(Marked(Next) == true) { continue; }
+        if(Curr->Next.compare_exchange_strong(Next, Next | 1, std::memory_order_acq_rel, std::memory_order_relaxed) == false) { continue; }
+        N_Items.fetch_sub(1, std::memory_order_relaxed);
+
+        // Unlink it. If Prev has changed, searching again unlinks it.
+        uintptr_t Expected = reinterpret_cast<uintptr_t>(Curr);
+        if(Prev->compare_exchange_strong(Expected, Next, std::memory_order_acq_rel, std::memory_order_relaxed) == true) {
+          Epochs.retire(static_cast<Key_Node*>(Curr));
+        } // if(Prev->compare_exchange_strong(Expected, Next, ...
+        else { Find(Start, Order, &key, Prev, Curr); }
+        return;
+      } // while(true) {
+    } // void remove(const K& key) {
+
+    /* Update the value of the item with the specified key by calling Fn(Value)
+    on a copy of its value (possibly more than once, see above). Returns false
+    (without calling Fn) if there is no item with the specified key. */
+    template<typename Function>
+    bool modify(const K& key, Function Fn) {
+      size_t Key_Hash = Hash_Of(key);
+      Epoch_Guard Guard(Epochs);
+
+      Key_Node* N = Find_Item(Dummy(Bucket_Of(Key_Hash)), key, Key_Hash);
+      if(N == NULL) { return false; }
+      Update(N, Fn);
+      return true;
+    } // bool modify(const K& key, Function Fn) {
+
+    /* If no item has the specified key, add one with value init. Otherwise,
+    merge init into (a copy of) the item's value with Merge(Value, init).
+    Returns true if a new item was added. */
+    template<typename Function>
+    bool upsert(const K& key, const V& init, Function Merge) {
+      size_t Key_Hash = Hash_Of(key);
+      Epoch_Guard Guard(Epochs);
+      Node* Start = Dummy(Bucket_Of(Key_Hash));
+
+      Key_Node* N = Find_Item(Start, key, Key_Hash);
+      if(N == NULL) {
+        std::unique_ptr<Key_Node> New(new Key_Node(Item_Order(Key_Hash), key, init));
+        if(Add(Start, New, N) == true) { return true; }
+      } // if(N == NULL) {
+
+      auto Merge_Init = [&Merge, &init](V& Value) { Merge(Value, init); };
+      Update(N, Merge_Init);
+      return false;
+    } // bool upsert(const K& key, const V& init, Function Merge) {
+
+    /* Call Fn(Value) on (a copy of) the value of the item with the specified
+    key. If there is no such item, one is added, with a value-initialized
+    value that Fn is called on before the item is linked in. Returns true if
+    a new item was added. */
+    template<typename Function>
+    bool compute(const K& key, Function Fn) {
+      size_t Key_Hash = Hash_Of(key);
+      Epoch_Guard Guard(Epochs);
+      Node* Start = Dummy(Bucket_Of(Key_Hash));
+
+      Key_Node* N = Find_Item(Start, key, Key_Hash);
+      if(N == NULL) {
+        std::unique_ptr<Key_Node> New(new Key_Node(Item_Order(Key_Hash), key));
+        Fn(*New->Value.load(std::memory_order_relaxed));
+        if(Add(Start, New, N) == true) { return true; }
+      } // if(N == NULL) {
+
+      Update(N, Fn);
+      return false;
+    } // bool compute(const K& key, Function Fn) {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Lookups
+
+    /* If an item has the specified key, copy its value into Value and return
+    true. Otherwise, return false (and leave Value alone). */
+    bool find(const K& key, V& Value) const {
+      size_t Key_Hash = Hash_Of(key);
+      Epoch_Guard Guard(Epochs);
+
+      const Key_Node* N = Find_Item(Lookup_Start(Key_Hash), key, Key_Hash);
+      if(N == NULL) { return false; }
+      Value = *N->Value.load(std::memory_order_acquire);
+      return true;
+    } // bool find(const K& key, V& Value) const {
+
+    /* Returns (a copy of) the value of the item with the specified key. Throws
+    an exception if no item with the specified key can be found. */
+    V search(const K& key) const {
+      size_t Key_Hash = Hash_Of(key);
+      Epoch_Guard Guard(Epochs);
+
+      const Key_Node* N = Find_Item(Lookup_Start(Key_Hash), key, Key_Hash);
+      if(N == NULL) {
+        char Error_Message_Buffer[500];
+        snprintf(Error_Message_Buffer, sizeof(Error_Message_Buffer),
+                 "Invalid Key Error: This hash table does not have an entry with key %s\n",
+                 Describe_Key(key).c_str());
+        throw Invalid_Key(Error_Message_Buffer);
+      } // if(N == NULL) {
+      return *N->Value.load(std::memory_order_acquire);
+    } // V search(const K& key) const {
+
+    // Returns true if the table has an item with the specified key.
+    bool contains(const K& key) const {
+      size_t Key_Hash = Hash_Of(key);
+      Epoch_Guard Guard(Epochs);
+      return Find_Item(Lookup_Start(Key_Hash), key, Key_Hash) != NULL;
+    } // bool contains(const K& key) const {
+
+    /* Returns the value of the item with the specified key, or Default if
+    there is no such item. */
+    V get_or(const K& key, const V& Default) const {
+      V Value(Default);
+      find(key, Value);
+      return Value;
+    } // V get_or(const K& key, const V& Default) const {
+
+
+    /* Printing method. Prints the list in order, one line per bucket that has
+    a dummy node. This isn't a snapshot if other threads are changing the
+    table. */
+    friend std::ostream & operator<<(std::ostream & os, const Split_Ordered_Hash_Table & Table) {
+      Epoch_Guard Guard(Table.Epochs);
+      bool After_Item = false;
+      for(const Node* N = Table.Find_Dummy(0); N != NULL; N = Pointer(N->Next.load(std::memory_order_acquire))) {
+        if(Marked(N->Next.load(std::memory_order_acquire)) == true) { continue; }
+
+        if((N->Order & 1) == 0) {
+          if(N != Table.Find_Dummy(0)) { os << std::endl; }
+          os << "Bucket " << Reverse_Bits(N->Order) << ": ";
+          After_Item = false;
+        } // if((N->Order & 1) == 0) {
+        else {
+          const Key_Node* Item = static_cast<const Key_Node*>(N);
+          if(After_Item == true) { os << " -> "; }
+          os << "{" << Item->key << " : " << *Item->Value.load(std::memory_order_acquire) << "}";
+          After_Item = true;
+        } // else
+      } // for(const Node* N = Table.Find_Dummy(0); N != NULL; N = ...
+      os << std::endl;
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Split_Ordered_Hash_Table & Table) {
+}; // class Split_Ordered_Hash_Table {
+
+template <typename K, typename V, typename Hash, typename KeyEqual>
+const unsigned Split_Ordered_Hash_Table<K, V, Hash, KeyEqual>::First_Segment_Size;
+template <typename K, typename V, typename Hash, typename KeyEqual>
+const unsigned Split_Ordered_Hash_Table<K, V, Hash, KeyEqual>::Max_Segments;
+template <typename K, typename V, typename Hash, typename KeyEqual>
+const unsigned Split_Ordered_Hash_Table<K, V, Hash, KeyEqual>::Max_Buckets;
+
+
+
+/* A hash table whose lookups don't write to memory at all, for small
+trivially copyable keys and values (like unsigned keys with double or small
+struct values). This is for read mostly workloads where even the epoch pins
+of Lock_Free_Read_Hash_Table (or the stripe locks of Striped_Hash_Table)
+cost too much.
+
+  - Items are stored inline in cache line sized buckets, a few to a bucket
+    (Slots_Per_Bucket, which depends on the size of K and V). An item goes
+    in its home bucket, or if that's full, the next bucket after it with
+    room. Each bucket counts the items that have overflowed past it (like
+    F14's outbound overflow counts), so lookups know to keep going; lookups
+    stop at the first bucket whose count is 0. Removing an item decrements
+    the counts it incremented, so (unlike a sticky "overflowed" bit) churn
+    doesn't leave every bucket marked and misses don't get slower over time.
+    Probing never wraps around. Instead, there are a few extra buckets at the end of
+    the array, and if an item runs off the end of those, the table grows.
+    Items never move between buckets (removing an item only moves the last
+    item of its bucket into its slot), except when the table grows.
+  - Each bucket has a sequence number, which is odd while a writer has the
+    bucket. Writers lock a bucket by making its sequence number odd (a
+    compare and swap) and unlock it by making it even again, so every change
+    to a bucket bumps its sequence number. Readers copy a bucket, then check
+    that its sequence number is the same even number it was before they
+    started. If it isn't, their copy might be torn, and they try again.
+    Since the bucket's contents are stored as atomic words (read and written
+    with relaxed loads and stores), a torn copy is never undefined behaviour,
+    and it's never used.
+  - A writer locks the key's home bucket for the whole update (so updates of
+    the same key are serialized), and the buckets after it one at a time, in
+    order. Everything locks buckets in increasing order, so this can't
+    deadlock.
+  - Growing locks every bucket of the array (for good), copies the items
+    into a new, bigger array, and publishes it. Readers and writers that find
+    the old array's buckets locked see that there's a new array and go on to
+    it. Old arrays are kept until the table is destroyed, since readers (who
+    never write, so can't tell anybody they're done) may still be reading
+    them. Since arrays at least double in size when they grow, the old ones
+    take up less memory than the current one.
+
+Lookups copy values out. Updates (modify, upsert, compute) call their
+function on the value while holding its bucket's lock, so they must not use
+the table. K and V must be trivially copyable and default constructible.
+Lookups that find a bucket being written spin (yielding now and then) until
+it's done, so they can be held up by writers, but they never hold up anyone
+else. */
+template <typename K, typename V,
+          typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>,
+          typename Growth = Modulo_Growth>
+class Seqlock_Hash_Table {
+  private:
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                  "Seqlock_Hash_Table needs trivially copyable keys and values");
+
+    struct Entry {
+      K key;
+      V value;
+    }; // struct Entry {
+
+  public:
+    // Each entry is stored as this many 64 bit words, and each bucket fits as many entries as will fit in a cache line.
+    static const unsigned Words_Per_Entry = (sizeof(Entry) + 7)/8;
+    static const unsigned Slots_Per_Bucket = (8*Words_Per_Entry <= 56) ? 56/(8*Words_Per_Entry) : 1;
+
+  private:
+    /* A bucket's Info packs its number of entries (the low Overflow_Shift
+    bits) and its overflow count (the rest). The overflow count saturates at
+    Max_Overflow (after which it's never decremented, so it stays correct if
+    pessimistic), which would take millions of items piled up behind one
+    bucket. */
+    static const unsigned Overflow_Shift = 8;
+    static const unsigned Overflow_One = 1u << Overflow_Shift;
+    static const unsigned Max_Overflow = ~0u >> Overflow_Shift;
+    static const unsigned Tail_Buckets = 8;  // Extra buckets at the end of each array, for items to overflow into
+
+    static_assert(Slots_Per_Bucket < Overflow_One, "Seqlock_Hash_Table's bucket counts don't fit in Info");
+
+    /* A bucket. Info is the number of entries in the bucket, plus Overflow_One
+    times the number of items whose home bucket is at or before this one but
+    which are stored after it. */
+    struct alignas(64) Bucket {
+      std::atomic<unsigned> Seq;
+      std::atomic<unsigned> Info;
+      std::atomic<uint64_t> Words[Slots_Per_Bucket*Words_Per_Entry];
+
+      Bucket() : Seq(0), Info(0) {}
+    }; // struct alignas(64) Bucket {
+
+    // A reader's copy of a bucket
+    struct Snapshot {
+      unsigned Info;
+      Entry Entries[Slots_Per_Bucket];
+    }; // struct Snapshot {
+
+    /* A bucket array. Items' home buckets are the first N_Buckets buckets;
+    the last Tail_Buckets buckets are just for overflow. */
+    struct Bucket_Array {
+      unsigned N_Buckets;
+      Growth Policy;
+      Aligned_Array<Bucket> Buckets;
+
+      explicit Bucket_Array(unsigned N_Buckets) : N_Buckets(N_Buckets), Policy(N_Buckets), Buckets(N_Buckets + Tail_Buckets) {}
+      unsigned End() const { return N_Buckets + Tail_Buckets; }
+    }; // struct Bucket_Array {
+
+    Hash Hasher;
+    KeyEqual Key_Equal;
+    float Max_Load_Factor;                 // Largest allowed N_Items/(N_Buckets*Slots_Per_Bucket)
+
+    std::atomic<Bucket_Array*> Array;      // The current bucket array
+    std::atomic<unsigned> N_Items;
+    mutable std::mutex Grow_Lock;          // Held while growing (and printing)
+    std::vector<Bucket_Array*> Old_Arrays; // Arrays we've grown out of (guarded by Grow_Lock)
+
+    Seqlock_Hash_Table(const Seqlock_Hash_Table &) = delete;
+    Seqlock_Hash_Table& operator=(const Seqlock_Hash_Table &) = delete;
+
+
+    static unsigned Count(unsigned Info) { return Info & (Overflow_One - 1); }
+    static unsigned Overflow(unsigned Info) { return Info >> Overflow_Shift; }
+
+    // Every so often, let whoever we're waiting for run.
+    static void Back_Off(unsigned& Attempts) {
+      if(++Attempts % 16 == 0) { std::this_thread::yield(); }
+    } // static void Back_Off(unsigned& Attempts) {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Buckets
+
+    // Copy entry s of bucket B into E, and E into entry s of B (a writer must have the bucket).
+    static void Get(const Bucket& B, unsigned s, Entry& E) {
+      uint64_t Buffer[Words_Per_Entry];
+      for(unsigned w = 0; w < Words_Per_Entry; w++) { Buffer[w] = B.Words[s*Words_Per_Entry + w].load(std::memory_order_relaxed); }
+      memcpy(&E, Buffer, sizeof(Entry));
+    } // static void Get(const Bucket& B, unsigned s, Entry& E) {
+
+    static void Put(Bucket& B, unsigned s, const Entry& E) {
+      uint64_t Buffer[Words_Per_Entry] = {};
+      memcpy(Buffer, &E, sizeof(Entry));
+      for(unsigned w = 0; w < Words_Per_Entry; w++) { B.Words[s*Words_Per_Entry + w].store(Buffer[w], std::memory_order_relaxed); }
+    } // static void Put(Bucket& B, unsigned s, const Entry& E) {
+
+    /* Copy bucket B into S. Returns false if a writer had the bucket (so S
+    may be torn). */
+    static bool Read(const Bucket& B, Snapshot& S) {
+      unsigned Seq = B.Seq.load(std::memory_order_acquire);
+      if((Seq & 1) == 1) { return false; }
+
+      S.Info = B.Info.load(std::memory_order_relaxed);
+      for(unsigned s = 0; s < Count(S.Info); s++) { Get(B, s, S.Entries[s]); }
+
+      // Don't let the copy move after the second check of the sequence number.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return B.Seq.load(std::memory_order_relaxed) == Seq;
+    } // static bool Read(const Bucket& B, Snapshot& S) {
+
+    /* Lock bucket B of array A. Returns false (without locking B) if A has
+    been replaced by a bigger array (whose buckets stay locked). */
+    bool Lock(const Bucket_Array* A, Bucket& B) const {
+      unsigned Attempts = 0;
+      while(true) {
+        unsigned Seq = B.Seq.load(std::memory_order_relaxed);
+        if((Seq & 1) == 0 && B.Seq.compare_exchange_weak(Seq, Seq + 1, std::memory_order_acquire, std::memory_order_relaxed) == true) {
+          // Readers must see the odd sequence number before any of our changes.
+          std::atomic_thread_fence(std::memory_order_release);
+          return true;
+        } // if((Seq & 1) == 0 && B.Seq.compare_exchange_weak(...) == true) {
+
+        if(Array.load(std::memory_order_acquire) != A) { return false; }
+        Back_Off(Attempts);
+      } // while(true) {
+    } // bool Lock(const Bucket_Array* A, Bucket& B) const {
+
+    static void Unlock(Bucket& B) { B.Seq.store(B.Seq.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /* Lock the home bucket of the key whose hash is Key_Hash in the current
+    array. A and H are set to the array and bucket. */
+    void Lock_Home(size_t Key_Hash, Bucket_Array*& A, unsigned& H) {
+      do {
+        A = Array.load(std::memory_order_acquire);
+        H = A->Policy.index(Key_Hash);
+      } while(Lock(A, A->Buckets[H]) == false);
+    } // void Lock_Home(size_t Key_Hash, Bucket_Array*& A, unsigned& H) {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Finding and adding entries (writers)
+
+    /* With bucket H (the key's home bucket) of A locked, find the key's entry.
+    Returns the bucket it's in (which is locked, if it isn't H), and sets
+    Slot. Returns A->End() if the key isn't in the table. */
+    unsigned Find_Locked(Bucket_Array* A, unsigned H, const K& key, unsigned& Slot) const {
+      Entry E;
+      for(unsigned i = H; i < A->End(); i++) {
+        Bucket& B = A->Buckets[i];
+        if(i != H) { Lock(A, B); }
+
+        unsigned Info = B.Info.load(std::memory_order_relaxed);
+        for(unsigned s = 0; s < Count(Info); s++) {
+          Get(B, s, E);
+          if(Key_Equal(E.key, key) == true) {
+            Slot = s;
+            return i;
+          } // if(Key_Equal(E.key, key) == true) {
+        } // for(unsigned s = 0; s < Count(Info); s++) {
+
+        if(i != H) { Unlock(B); }
+        if(Overflow(Info) == 0) { break; }
+      } // for(unsigned i = H; i < A->End(); i++) {
+      return A->End();
+    } // unsigned Find_Locked(Bucket_Array* A, unsigned H, const K& key, unsigned& Slot) const {
+
+    /* With bucket H (E's home bucket) of A locked, and E's key not in the
+    table, add E to the first bucket from H on with room, incrementing the
+    overflow counts of the full buckets we pass. Returns false if we run off
+    the end of the array (the counts don't matter then, since the array is
+    about to be replaced). */
+    bool Add_Locked(Bucket_Array* A, unsigned H, const Entry& E) const {
+      for(unsigned i = H; i < A->End(); i++) {
+        Bucket& B = A->Buckets[i];
+        if(i != H) { Lock(A, B); }
+
+        unsigned Info = B.Info.load(std::memory_order_relaxed);
+        bool Room = (Count(Info) < Slots_Per_Bucket);
+        if(Room == true) {
+          Put(B, Count(Info), E);
+          B.Info.store(Info + 1, std::memory_order_relaxed);
+        } // if(Room == true) {
+        else if(Overflow(Info) != Max_Overflow) { B.Info.store(Info + Overflow_One, std::memory_order_relaxed); }
+
+        if(i != H) { Unlock(B); }
+        if(Room == true) { return true; }
+      } // for(unsigned i = H; i < A->End(); i++) {
+      return false;
+    } // bool Add_Locked(Bucket_Array* A, unsigned H, const Entry& E) const {
+
+    enum Update_Result { Updated, Added, Not_Found };
+
+    /* Every update. If an item has the specified key, call Fn(Value) on its
+    value (with its bucket locked). Otherwise, if Add is true, add an item
+    whose value is Make() (Make is called at most once). */
+    template<typename Function, typename Make_Function>
+    Update_Result Update(const K& key, Function& Fn, bool Add, Make_Function& Make) {
+      size_t Key_Hash = Hasher(key);
+      Entry New;
+      bool Made = false;
+
+      while(true) {
+        Bucket_Array* A;
+        unsigned H;
+        Lock_Home(Key_Hash, A, H);
+        Bucket& Home = A->Buckets[H];
+
+        unsigned Slot = 0;
+        unsigned i = Find_Locked(A, H, key, Slot);
+        if(i != A->End()) {
+          Bucket& B = A->Buckets[i];
+          Entry E;
+          Get(B, Slot, E);
+          try { Fn(E.value); }
+          catch(...) {
+            if(i != H) { Unlock(B); }
+            Unlock(Home);
+            throw;
+          } // catch(...) {
+          Put(B, Slot, E);
+
+          if(i != H) { Unlock(B); }
+          Unlock(Home);
+          return Updated;
+        } // if(i != A->End()) {
+
+        if(Add == false) {
+          Unlock(Home);
+          return Not_Found;
+        } // if(Add == false) {
+
+        if(Made == false) {
+          New.key = key;
+          try { New.value = Make(); }
+          catch(...) {
+            Unlock(Home);
+            throw;
+          } // catch(...) {
+          Made = true;
+        } // if(Made == false) {
+
+        bool Room = Add_Locked(A, H, New);
+        Unlock(Home);
+        if(Room == true) {
+          N_Items.fetch_add(1, std::memory_order_relaxed);
+          Grow_If_Needed();
+          return Added;
+        } // if(Room == true) {
+
+        // The item overflowed off the end of the array, so grow it and try again.
+        Grow(A);
+      } // while(true) {
+    } // Update_Result Update(const K& key, Function& Fn, bool Add, Make_Function& Make) {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Growing
+
+    /* Copy A's items into New (which nobody else can see yet). Returns false
+    if an item runs off the end of New. */
+    bool Copy(const Bucket_Array* A, Bucket_Array* New) const {
+      Entry E;
+      for(unsigned i = 0; i < A->End(); i++) {
+        const Bucket& B = A->Buckets[i];
+        for(unsigned s = 0; s < Count(B.Info.load(std::memory_order_relaxed)); s++) {
+          Get(B, s, E);
+          unsigned H = New->Policy.index(Hasher(E.key));
+
+          // Nobody else has New, so locking its buckets never waits.
+          Lock(New, New->Buckets[H]);
+          bool Room = Add_Locked(New, H, E);
+          Unlock(New->Buckets[H]);
+          if(Room == false) { return false; }
+        } // for(unsigned s = 0; s < Count(B.Info.load(std::memory_order_relaxed)); s++) {
+      } // for(unsigned i = 0; i < A->End(); i++) {
+      return true;
+    } // bool Copy(const Bucket_Array* A, Bucket_Array* New) const {
+
+    /* Replace A with a bigger array (at least doubling the number of buckets,
+    as the growth policy decides), unless someone already has. */
+    void Grow(Bucket_Array* A) {
+      std::lock_guard<std::mutex> Guard(Grow_Lock);
+      if(Array.load(std::memory_order_acquire) != A) { return; }
+      Old_Arrays.reserve(Old_Arrays.size() + 1);
+
+      // Once we have every bucket, nobody can change A.
+      for(unsigned i = 0; i < A->End(); i++) { Lock(A, A->Buckets[i]); }
+
+      try {
+        unsigned New_N_Buckets = Growth::size(Growth::grow(A->N_Buckets));
+        while(N_Items.load(std::memory_order_relaxed) > Max_Load_Factor*New_N_Buckets*Slots_Per_Bucket) {
+          New_N_Buckets = Growth::size(Growth::grow(New_N_Buckets));
+        } // while(N_Items.load(std::memory_order_relaxed) > Max_Load_Factor*New_N_Buckets*Slots_Per_Bucket) {
+
+        std::unique_ptr<Bucket_Array> New(new Bucket_Array(New_N_Buckets));
+        while(Copy(A, New.get()) == false) {
+          New.reset(new Bucket_Array(Growth::size(Growth::grow(New->N_Buckets))));
+        } // while(Copy(A, New.get()) == false) {
+
+        // A's buckets stay locked, which sends everyone waiting on them to the new array.
+        Old_Arrays.push_back(A);
+        Array.store(New.release(), std::memory_order_release);
+      } // try {
+      catch(...) {
+        for(unsigned i = 0; i < A->End(); i++) { Unlock(A->Buckets[i]); }
+        throw;
+      } // catch(...) {
+    } // void Grow(Bucket_Array* A) {
+
+    void Grow_If_Needed() {
+      Bucket_Array* A = Array.load(std::memory_order_acquire);
+      if(N_Items.load(std::memory_order_relaxed) > Max_Load_Factor*A->N_Buckets*Slots_Per_Bucket) { Grow(A); }
+    } // void Grow_If_Needed() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Lookups
+
+    /* Look for the key whose hash is Key_Hash in A, without locking. Returns
+    false if a bucket we needed was being written (so we have to try again).
+    Otherwise, sets Found (and if Found, Value). */
+    bool Try_Find(const Bucket_Array* A, size_t Key_Hash, const K& key, bool& Found, V& Value) const {
+      Snapshot S;
+      for(unsigned i = A->Policy.index(Key_Hash); i < A->End(); i++) {
+        if(Read(A->Buckets[i], S) == false) { return false; }
+
+        for(unsigned s = 0; s < Count(S.Info); s++) {
+          if(Key_Equal(S.Entries[s].key, key) == true) {
+            Found = true;
+            Value = S.Entries[s].value;
+            return true;
+          } // if(Key_Equal(S.Entries[s].key, key) == true) {
+        } // for(unsigned s = 0; s < Count(S.Info); s++) {
+
+        if(Overflow(S.Info) == 0) { break; }
+      } // for(unsigned i = A->Policy.index(Key_Hash); i < A->End(); i++) {
+
+      Found = false;
+      return true;
+    } // bool Try_Find(const Bucket_Array* A, size_t Key_Hash, const K& key, bool& Found, V& Value) const {
+
+    // Look for the key (in the current array). Returns true, and sets Value, if we find it.
+    bool Find(const K& key, V& Value) const {
+      size_t Key_Hash = Hasher(key);
+      unsigned Attempts = 0;
+      bool Found;
+      while(Try_Find(Array.load(std::memory_order_acquire), Key_Hash, key, Found, Value) == false) { Back_Off(Attempts); }
+      return Found;
+    } // bool Find(const K& key, V& Value) const {
+
+  public:
+    /* Constructor, destructor. The max load factor is in items per slot (0
+    means the default, 0.75). */
+    Seqlock_Hash_Table(unsigned N_Buckets = 11, float Max_Load_Factor = 0.75,
+                       const Hash& Hasher = Hash(), const KeyEqual& Key_Equal = KeyEqual())
+        : Hasher(Hasher), Key_Equal(Key_Equal), Max_Load_Factor((Max_Load_Factor <= 0 || Max_Load_Factor > 1) ? 0.75f : Max_Load_Factor), N_Items(0) {
+      Array.store(new Bucket_Array(Growth::size(N_Buckets)));
+    } // Seqlock_Hash_Table(unsigned N_Buckets = 11, float Max_Load_Factor = 0.75, ...
+
+    ~Seqlock_Hash_Table() {
+      delete Array.load();
+      for(unsigned i = 0; i < Old_Arrays.size(); i++) { delete Old_Arrays[i]; }
+    } // ~Seqlock_Hash_Table() {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Size, load factor methods
+
+    unsigned size() const { return N_Items.load(std::memory_order_relaxed); }
+    unsigned bucket_count() const { return Array.load(std::memory_order_acquire)->N_Buckets; }
+    float load_factor() const { return ((float)size())/(bucket_count()*Slots_Per_Bucket); }
+    float max_load_factor() const { return Max_Load_Factor; }
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Updates
+
+    /* Insert an item into the table. If an item with the specified key is
+    already in the table, its value is updated. */
+    void insert(const K& key, const V& value) { insert_or_assign(key, value); }
+
+    /* Set the value of the item with the specified key to value (adding an
+    item if there isn't one). Returns true if a new item was added. */
+    bool insert_or_assign(const K& key, const V& value) {
+      auto Assign = [&value](V& Value) { Value = value; };
+      auto Make = [&value]() { return value; };
+      return Update(key, Assign, true, Make) == Added;
+    } // bool insert_or_assign(const K& key, const V& value) {
+
+    /* Add an item whose value is constructed from args, unless an item with
+    the specified key is already in the table. Returns true if a new item was
+    added. */
+    template<typename... Args>
+    bool emplace(const K& key, Args&&... args) {
+      auto Keep = [](V&) {};
+      auto Make = [&]() { return V(std::forward<Args>(args)...); };
+      return Update(key, Keep, true, Make) == Added;
+    } // bool emplace(const K& key, Args&&... args) {
+
+    // remove the value with the specified key from the table.
+    void remove(const K& key) {
+      Bucket_Array* A;
+      unsigned H;
+      Lock_Home(Hasher(key), A, H);
+      Bucket& Home = A->Buckets[H];
+
+      unsigned Slot = 0;
+      unsigned i = Find_Locked(A, H, key, Slot);
+      if(i == A->End()) {
+        Unlock(Home);
+        return;
+      } // if(i == A->End()) {
+
+      // Move the bucket's last entry into the removed one's slot.
+      Bucket& B = A->Buckets[i];
+      unsigned Info = B.Info.load(std::memory_order_relaxed);
+      if(Slot != Count(Info) - 1) {
+        Entry Last;
+        Get(B, Count(Info) - 1, Last);
+        Put(B, Slot, Last);
+      } // if(Slot != Count(Info) - 1) {
+      B.Info.store(Info - 1, std::memory_order_relaxed);
+      if(i != H) { Unlock(B); }
+
+      /* The item overflowed past buckets H through i - 1, so decrement their
+      overflow counts. We still have H, and (having let go of B) lock the
+      rest in increasing order. Until we're done, the counts are only too
+      high, which just makes lookups look further than they need to. */
+      for(unsigned j = H; j < i; j++) {
+        Bucket& Passed = A->Buckets[j];
+        if(j != H) { Lock(A, Passed); }
+
+        unsigned Passed_Info = Passed.Info.load(std::memory_order_relaxed);
+        if(Overflow(Passed_Info) != Max_Overflow) { Passed.Info.store(Passed_Info - Overflow_One, std::memory_order_relaxed); }
+
+        if(j != H) { Unlock(Passed); }
+      } // for(unsigned j = H; j < i; j++) {
+
+      Unlock(Home);
+      N_Items.fetch_sub(1, std::memory_order_relaxed);
+    } // void remove(const K& key) {
+
+    /* Update the value of the item with the specified key by calling
+    Fn(Value) on it. Returns false (without calling Fn) if there is no item
+    with the specified key. */
+    template<typename Function>
+    bool modify(const K& key, Function Fn) {
+      auto Make = []() { return V(); };
+      return Update(key, Fn, false, Make) == Updated;
+    } // bool modify(const K& key, Function Fn) {
+
+    /* If no item has the specified key, add one with value init. Otherwise,
+    merge init into its value with Merge(Value, init). Returns true if a new
+    item was added. */
+    template<typename Function>
+    bool upsert(const K& key, const V& init, Function Merge) {
+      auto Merge_Init = [&Merge, &init](V& Value) { Merge(Value, init); };
+      auto Make = [&init]() { return init; };
+      return Update(key, Merge_Init, true, Make) == Added;
+    } // bool upsert(const K& key, const V& init, Function Merge) {
+
+    /* Call Fn(Value) on the value of the item with the specified key. If there
+    is no such item, one is added, with a value-initialized value that Fn is
+    called on first. Returns true if a new item was added. */
+    template<typename Function>
+    bool compute(const K& key, Function Fn) {
+      auto Make = [&Fn]() {
+        V Value = V();
+        Fn(Value);
+        return Value;
+      }; // auto Make = [&Fn]() {
+      return Update(key, Fn, true, Make) == Added;
+    } // bool compute(const K& key, Function Fn) {
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Lookups (none of these write to shared memory)
+
+    /* If an item has the specified key, copy its value into Value and return
+    true. Otherwise, return false (and leave Value alone). */
+    bool find(const K& key, V& Value) const {
+      V Found_Value;
+      if(Find(key, Found_Value) == false) { return false; }
+      Value = Found_Value;
+      return true;
+    } // bool find(const K& key, V& Value) const {
+
+    /* Returns (a copy of) the value of the item with the specified key. Throws
+    an exception if no item with the specified key can be found. */
+    V search(const K& key) const {
+      V Value;
+      if(Find(key, Value) == false) {
+        char Error_Message_Buffer[500];
+        snprintf(Error_Message_Buffer, sizeof(Error_Message_Buffer),
+                 "Invalid Key Error: This hash table does not have an entry with key %s\n",
+                 Describe_Key(key).c_str());
+        throw Invalid_Key(Error_Message_Buffer);
+      } // if(Find(key, Value) == false) {
+      return Value;
+    } // V search(const K& key) const {
+
+    // Returns true if the table has an item with the specified key.
+    bool contains(const K& key) const {
+      V Value;
+      return Find(key, Value);
+    } // bool contains(const K& key) const {
+
+    /* Returns the value of the item with the specified key, or Default if
+    there is no such item. */
+    V get_or(const K& key, const V& Default) const {
+      V Value(Default);
+      find(key, Value);
+      return Value;
+    } // V get_or(const K& key, const V& Default) const {
+
+
+    /* Printing method. Holding Grow_Lock keeps the array from being replaced
+    while we print it. Each bucket is a consistent copy, but this isn't a
+    snapshot of the whole table if other threads are changing it. */
+    friend std::ostream & operator<<(std::ostream & os, const Seqlock_Hash_Table & Table) {
+      std::lock_guard<std::mutex> Guard(Table.Grow_Lock);
+      const Bucket_Array* A = Table.Array.load(std::memory_order_acquire);
+
+      Snapshot S;
+      for(unsigned i = 0; i < A->End(); i++) {
+        unsigned Attempts = 0;
+        while(Read(A->Buckets[i], S) == false) { Back_Off(Attempts); }
+
+        os << "Bucket " << i << ": ";
+        for(unsigned s = 0; s < Count(S.Info); s++) {
+          os << "{" << S.Entries[s].key << " : " << S.Entries[s].value << "}";
+          if(s + 1 < Count(S.Info)) { os << " -> "; }
+        } // for(unsigned s = 0; s < Count(S.Info); s++) {
+        if(Overflow(S.Info) != 0) { os << " (" << Overflow(S.Info) << " overflowed)"; }
+        os << std::endl;
+      } // for(unsigned i = 0; i < A->End(); i++) {
+
+      return os;
+    } // friend std::ostream & operator<<(std::ostream & os, const Seqlock_Hash_Table & Table) {
+}; // class Seqlock_Hash_Table {
+
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Growth>
+const unsigned Seqlock_Hash_Table<K, V, Hash, KeyEqual, Growth>::Words_Per_Entry;
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Growth>
+const unsigned Seqlock_Hash_Table<K, V, Hash, KeyEqual, Growth>::Slots_Per_Bucket;
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Growth>
+const unsigned Seqlock_Hash_Table<K, V, Hash, KeyEqual, Growth>::Overflow_Shift;
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Growth>
+const unsigned Seqlock_Hash_Table<K, V, Hash, KeyEqual, Growth>::Overflow_One;
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Growth>
+const unsigned Seqlock_Hash_Table<K, V, Hash, KeyEqual, Growth>::Max_Overflow;
+template <typename K, typename V, typename Hash, typename KeyEqual, typename Growth>
+const unsigned Seqlock_Hash_Table<K, V, Hash, KeyEqual, Growth>::Tail_Buckets;
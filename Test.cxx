@@ -1,5 +1,11 @@
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 #include "HashTable.cxx"
 
 // Unit testing stuff
@@ -76,12 +82,12 @@ TEST_CASE("Item List tests", "[Item_List]") {
 
 
 
-void Print_Table(const Hash_Table<double> & H) { std::cout << H; }
+void Print_Table(const Hash_Table<unsigned, double> & H) { std::cout << H; }
 
 TEST_CASE("Hash Table tests!", "[Hash_Table]") {
   /* First, let's make a hashtable of doubles. We'll use the default number of
   buckets for now. */
-  Hash_Table<double> H{};
+  Hash_Table<unsigned, double> H{};
 
   /* Let's try searching for some items. Since the table is empty, all of these
   attempts should throw an exception */
@@ -120,3 +126,1366 @@ TEST_CASE("Hash Table tests!", "[Hash_Table]") {
   H.remove(key4);
   REQUIRE_THROWS( H.search(key4) );
 } // TEST_CASE("Hash Table tests!", "[Hash_Table]") {
+
+
+
+TEST_CASE("Hash Table rehash tests", "[Hash_Table]") {
+  /* Make a small table and then insert far more items than it has buckets.
+  The table should grow to keep its load factor below the max load factor. */
+  Hash_Table<unsigned, double> H{11, 0.75};
+  REQUIRE( H.bucket_count() == 11 );
+  REQUIRE( H.max_load_factor() == 0.75f );
+
+  const unsigned N_Keys = 5000;
+  for(unsigned i = 0; i < N_Keys; i++) { H.insert(i*11, i + 0.5); }
+
+  REQUIRE( H.size() == N_Keys );
+  REQUIRE( H.bucket_count() > 11 );
+  REQUIRE( H.load_factor() <= H.max_load_factor() );
+
+  // Every item should have survived the rehashes.
+  for(unsigned i = 0; i < N_Keys; i++) { REQUIRE( H.search(i*11) == i + 0.5 ); }
+
+  /* Updating an existing key shouldn't change the size, and removing an item
+  (or a key that isn't in the table) should be reflected in the size. */
+  H.insert(0, 1.0);
+  REQUIRE( H.size() == N_Keys );
+  H.remove(0);
+  H.remove(0);
+  REQUIRE( H.size() == N_Keys - 1 );
+  REQUIRE_THROWS( H.search(0) );
+
+  // Explicitly rehashing into a new bucket count should keep every item.
+  H.rehash(20011);
+  REQUIRE( H.bucket_count() == 20011 );
+  for(unsigned i = 1; i < N_Keys; i++) { REQUIRE( H.search(i*11) == i + 0.5 ); }
+
+  // With modulo growth, bucket counts are always odd.
+  H.rehash(20000);
+  REQUIRE( H.bucket_count() == 20001 );
+  H.reserve(30000);
+  REQUIRE( H.bucket_count() % 2 == 1 );
+  for(unsigned i = 1; i < N_Keys; i++) { REQUIRE( H.search(i*11) == i + 0.5 ); }
+
+  // Lowering the max load factor should grow the table immediately.
+  H.max_load_factor(0.1);
+  REQUIRE( H.load_factor() <= 0.1f );
+  for(unsigned i = 1; i < N_Keys; i++) { REQUIRE( H.search(i*11) == i + 0.5 ); }
+} // TEST_CASE("Hash Table rehash tests", "[Hash_Table]") {
+
+
+
+TEST_CASE("Hash Table incremental rehash tests", "[Hash_Table]") {
+  /* Make a table that migrates one old bucket per operation. Growing the table
+  should leave it in the middle of an incremental rehash. */
+  Hash_Table<unsigned, double> H{11};
+  H.rehash_step(1);
+  REQUIRE( H.rehash_step() == 1 );
+
+  for(unsigned i = 0; i < 12; i++) { H.insert(i, i + 0.25); }
+  REQUIRE( H.rehashing() == true );
+  REQUIRE( H.bucket_count() == 23 );
+
+  /* Every item should be accessible while the table is rehashing, whether or
+  not its old bucket has been migrated yet. */
+  for(unsigned i = 0; i < 12; i++) { REQUIRE( H.search(i) == i + 0.25 ); }
+  REQUIRE_THROWS( H.search(100) );
+
+  // Lookups don't migrate anything (so that several threads can look things up at once).
+  for(unsigned i = 0; i < 100; i++) { REQUIRE( H.search(0) == 0.25 ); }
+  REQUIRE( H.rehashing() == true );
+
+  // Updates and removals should also work in the middle of a rehash.
+  H.rehash(11);
+  for(unsigned i = 0; i < 12; i++) { H.insert(i, i + 0.25); }
+  H.insert(11, 2.5);
+  H.remove(3);
+  REQUIRE( H.size() == 11 );
+  REQUIRE( H.search(11) == 2.5 );
+  REQUIRE_THROWS( H.search(3) );
+
+  // Updates migrate buckets, so eventually the rehash finishes on its own.
+  for(unsigned i = 0; i < 11 && H.rehashing(); i++) { H.remove(100); }
+  REQUIRE( H.rehashing() == false );
+
+  /* Now insert lots of items. The table should go through many incremental
+  rehashes without losing anything. */
+  const unsigned N_Keys = 5000;
+  for(unsigned i = 0; i < N_Keys; i++) { H.insert(i*16, i + 0.5); }
+  REQUIRE( H.size() == 11 + N_Keys - 1 );      // key 0 was already in the table
+  for(unsigned i = 0; i < N_Keys; i++) { REQUIRE( H.search(i*16) == i + 0.5 ); }
+
+  // Turning incremental rehashing off should finish any migration.
+  H.rehash_step(0);
+  REQUIRE( H.rehashing() == false );
+  REQUIRE( H.load_factor() <= H.max_load_factor() );
+
+  /* With a max load factor below 1 there are fewer inserts than old buckets
+  before the next growth, so Rehash_Step buckets per operation isn't enough.
+  The migration should still be done by the time the table is full again, so
+  that growing never has to finish it in one go. */
+  Hash_Table<unsigned, double> L{11};
+  L.rehash_step(1);
+  L.max_load_factor(0.25);
+
+  unsigned N_Growths = 0;
+  for(unsigned i = 0; i < N_Keys; i++) {
+    unsigned N_Buckets = L.bucket_count();
+    if(L.size() + 1 > L.max_load_factor()*N_Buckets) { REQUIRE( L.rehashing() == false ); }
+
+    L.insert(i, i + 0.5);
+    if(L.bucket_count() != N_Buckets) {
+      REQUIRE( L.rehashing() == true );
+      N_Growths++;
+    } // if(L.bucket_count() != N_Buckets) {
+  } // for(unsigned i = 0; i < N_Keys; i++) {
+  REQUIRE( N_Growths > 5 );
+  for(unsigned i = 0; i < N_Keys; i++) { REQUIRE( L.search(i) == i + 0.5 ); }
+} // TEST_CASE("Hash Table incremental rehash tests", "[Hash_Table]") {
+
+
+
+
+/* Do a long random sequence of inserts, updates, and removals on a table and
+check that it always agrees with a std::map. This is used to test each storage
+engine. */
+template<typename Table>
+void Check_Against_Map(Table& H, unsigned N_Operations, unsigned Key_Range) {
+  std::map<unsigned, double> Reference;
+  srand(1);
+
+  for(unsigned i = 0; i < N_Operations; i++) {
+    unsigned key = rand() % Key_Range;
+
+    // Insert (or update) two thirds of the time, remove the other third.
+    if(rand() % 3 != 0) {
+      double value = rand()/3.0;
+      H.insert(key, value);
+      Reference[key] = value;
+    } // if(rand() % 3 != 0) {
+    else {
+      H.remove(key);
+      Reference.erase(key);
+    } // else
+  } // for(unsigned i = 0; i < N_Operations; i++) {
+
+  REQUIRE( H.size() == Reference.size() );
+  REQUIRE( H.load_factor() <= H.max_load_factor() );
+  for(unsigned key = 0; key < Key_Range; key++) {
+    if(Reference.count(key) == 1) { REQUIRE( H.search(key) == Reference[key] ); }
+    else { REQUIRE_THROWS( H.search(key) ); }
+  } // for(unsigned key = 0; key < Key_Range; key++) {
+} // void Check_Against_Map(Table& H, unsigned N_Operations, unsigned Key_Range) {
+
+
+/* Run Check<Table>() on a Hash_Table<K, V, Hash, Equal, Storage> for every
+storage engine. Checks of things that every engine supports are templates on
+the table type, so that each test can run its check on every engine with
+this (and adding an engine means adding it here, once). */
+#define CHECK_EVERY_ENGINE(Check, K, V, Hash, Equal)                           \
+  do {                                                                         \
+    Check< Hash_Table<K, V, Hash, Equal, Chained_Storage> >();                 \
+    Check< Hash_Table<K, V, Hash, Equal, Linear_Probe_Storage> >();            \
+    Check< Hash_Table<K, V, Hash, Equal, Robin_Hood_Storage> >();              \
+    Check< Hash_Table<K, V, Hash, Equal, Unrolled_Storage> >();                \
+    Check< Hash_Table<K, V, Hash, Equal, Inline_Chained_Storage> >();          \
+    Check< Hash_Table<K, V, Hash, Equal, Swiss_Storage> >();                   \
+  } while(0)
+
+
+
+TEST_CASE("Linear probing tests", "[Linear_Probe_Storage]") {
+  Hash_Table<unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>, Linear_Probe_Storage> H{};
+  REQUIRE( H.bucket_count() == 11 );
+  REQUIRE_THROWS( H.search(3) );
+
+  /* Keys 0, 11, and 22 all have the same home slot, and key 1's home slot is
+  where key 11 ends up. This gives us one long probe run. */
+  H.insert(0, 1.5);
+  H.insert(11, 2.5);
+  H.insert(22, 3.5);
+  H.insert(1, 4.5);
+  REQUIRE( H.size() == 4 );
+  REQUIRE( H.search(0) == 1.5 );
+  REQUIRE( H.search(11) == 2.5 );
+  REQUIRE( H.search(22) == 3.5 );
+  REQUIRE( H.search(1) == 4.5 );
+  REQUIRE_THROWS( H.search(33) );
+
+  // Updating a key shouldn't add a new item.
+  H.insert(22, 5.5);
+  REQUIRE( H.size() == 4 );
+  REQUIRE( H.search(22) == 5.5 );
+
+  /* Removing the first item in the run should shift the rest of the run back
+  so that every other item is still reachable. */
+  H.remove(0);
+  REQUIRE_THROWS( H.search(0) );
+  REQUIRE( H.search(11) == 2.5 );
+  REQUIRE( H.search(22) == 5.5 );
+  REQUIRE( H.search(1) == 4.5 );
+  REQUIRE( H.size() == 3 );
+
+  // Now check the table against a std::map (this also makes it grow).
+  Check_Against_Map(H, 20000, 3000);
+} // TEST_CASE("Linear probing tests", "[Linear_Probe_Storage]") {
+
+
+
+TEST_CASE("Swiss table tests", "[Swiss_Storage]") {
+  Hash_Table<unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>, Swiss_Storage> H{};
+  REQUIRE( H.bucket_count() == 16 );
+  REQUIRE_THROWS( H.search(3) );
+
+  // Fill the table up to its max load factor.
+  for(unsigned i = 0; i < 14; i++) { H.insert(i*16, i + 0.5); }
+  REQUIRE( H.bucket_count() == 16 );
+  for(unsigned i = 0; i < 14; i++) { REQUIRE( H.search(i*16) == i + 0.5 ); }
+  REQUIRE_THROWS( H.search(1) );
+
+  // One more item should make the table grow.
+  H.insert(1000, 2.0);
+  REQUIRE( H.bucket_count() == 32 );
+  REQUIRE( H.size() == 15 );
+  for(unsigned i = 0; i < 14; i++) { REQUIRE( H.search(i*16) == i + 0.5 ); }
+
+  // Update, remove
+  H.insert(1000, 3.0);
+  REQUIRE( H.search(1000) == 3.0 );
+  H.remove(1000);
+  REQUIRE_THROWS( H.search(1000) );
+  REQUIRE( H.size() == 14 );
+
+  /* Lots of inserts and removals in a small key range leave lots of deleted
+  slots behind, which the table needs to clean up. */
+  Check_Against_Map(H, 50000, 500);
+
+  Hash_Table<unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>, Swiss_Storage> H2{};
+  Check_Against_Map(H2, 20000, 5000);
+} // TEST_CASE("Swiss table tests", "[Swiss_Storage]") {
+
+
+
+TEST_CASE("Robin Hood tests", "[Robin_Hood_Storage]") {
+  Hash_Table<unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>, Robin_Hood_Storage> H{};
+  REQUIRE( H.max_load_factor() == 0.9f );
+  REQUIRE_THROWS( H.search(3) );
+
+  /* Keys 0, 11 and 22 share a home slot, and key 1's home slot is the slot
+  that key 11 wants. Key 1 should be displaced by 11 and 22 (which are
+  further from home). */
+  H.insert(1, 4.5);
+  H.insert(0, 1.5);
+  H.insert(11, 2.5);
+  H.insert(22, 3.5);
+  REQUIRE( H.search(0) == 1.5 );
+  REQUIRE( H.search(11) == 2.5 );
+  REQUIRE( H.search(22) == 3.5 );
+  REQUIRE( H.search(1) == 4.5 );
+  REQUIRE( H.max_probe_length() == 3 );
+  REQUIRE_THROWS( H.search(33) );
+
+  // Removing an item should shift the rest of its run back.
+  H.remove(0);
+  REQUIRE_THROWS( H.search(0) );
+  REQUIRE( H.search(11) == 2.5 );
+  REQUIRE( H.search(22) == 3.5 );
+  REQUIRE( H.search(1) == 4.5 );
+  REQUIRE( H.max_probe_length() == 2 );
+
+  // Now check the table against a std::map at a high load factor.
+  Check_Against_Map(H, 50000, 5000);
+  REQUIRE( H.load_factor() > 0.4 );
+} // TEST_CASE("Robin Hood tests", "[Robin_Hood_Storage]") {
+
+
+
+
+/* A composite key, with its own hash and equality functors (rather than
+specializations of std::hash and std::equal_to). */
+struct Point { int x, y; };
+
+struct Point_Hash {
+  size_t operator()(const Point& p) const { return std::hash<int>()(p.x)*31 + std::hash<int>()(p.y); }
+}; // struct Point_Hash {
+
+struct Point_Equal {
+  bool operator()(const Point& a, const Point& b) const { return a.x == b.x && a.y == b.y; }
+}; // struct Point_Equal {
+
+
+// Check that a table with Point keys works.
+template<typename Table>
+void Check_Point_Keys() {
+  Table H{};
+  for(int x = -20; x < 20; x++) {
+    for(int y = -20; y < 20; y++) { H.insert(Point{x, y}, x*100.0 + y); }
+  } // for(int x = -20; x < 20; x++) {
+
+  REQUIRE( H.size() == 1600 );
+  REQUIRE( H.search(Point{-3, 7}) == -293.0 );
+  REQUIRE( H.search(Point{19, -20}) == 1880.0 );
+  REQUIRE_THROWS( H.search(Point{20, 0}) );
+
+  H.remove(Point{-3, 7});
+  REQUIRE_THROWS( H.search(Point{-3, 7}) );
+  REQUIRE( H.size() == 1599 );
+} // void Check_Point_Keys() {
+
+
+TEST_CASE("Generic key tests", "[Hash_Table]") {
+  // std::string keys (using std::hash<std::string>)
+  Hash_Table<std::string, double> H{};
+  H.insert("one", 1.0);
+  H.insert("two", 2.0);
+  H.insert(std::string(100, 'x'), 3.0);
+  REQUIRE( H.search("one") == 1.0 );
+  REQUIRE( H.search("two") == 2.0 );
+  REQUIRE( H.search(std::string(100, 'x')) == 3.0 );
+  REQUIRE_THROWS_AS( H.search("three"), Invalid_Key );
+  H.remove("one");
+  REQUIRE_THROWS( H.search("one") );
+
+  // 64 bit keys that don't fit in an unsigned
+  Hash_Table<uint64_t, double> H64{};
+  H64.insert(1ull << 40, 1.5);
+  H64.insert((1ull << 40) + 1, 2.5);
+  REQUIRE( H64.search(1ull << 40) == 1.5 );
+  REQUIRE( H64.search((1ull << 40) + 1) == 2.5 );
+  REQUIRE_THROWS( H64.search(0) );
+
+  // Composite keys, in every storage engine
+  CHECK_EVERY_ENGINE(Check_Point_Keys, Point, double, Point_Hash, Point_Equal);
+} // TEST_CASE("Generic key tests", "[Hash_Table]") {
+
+
+
+TEST_CASE("Growth policy tests", "[Growth]") {
+  // Prime_Growth's fastmod should agree with %.
+  Prime_Growth Primes(Prime_Growth::size(1000));
+  REQUIRE( Prime_Growth::size(1000) == 1597 );
+  for(unsigned i = 0; i < 10000; i++) {
+    uint32_t Hash = (uint32_t)rand()*2654435761u;
+    REQUIRE( Primes.index(Hash) == Hash % 1597 );
+  } // for(unsigned i = 0; i < 10000; i++) {
+
+  // Power_Of_Two_Growth should round up to powers of two.
+  REQUIRE( Power_Of_Two_Growth::size(11) == 16 );
+  REQUIRE( Power_Of_Two_Growth::size(1000) == 1024 );
+  REQUIRE( Power_Of_Two_Growth::size(1u << 31) == 1u << 31 );
+  REQUIRE( Power_Of_Two_Growth::grow(1u << 30) == 1u << 31 );
+
+  // There are no bigger powers of two, so asking for one should throw (not loop forever).
+  REQUIRE_THROWS_AS( Power_Of_Two_Growth::size((1u << 31) + 1), std::length_error );
+  REQUIRE_THROWS_AS( Power_Of_Two_Growth::grow(1u << 31), std::length_error );
+
+  // Power of two tables
+  typedef std::hash<unsigned> H;
+  typedef std::equal_to<unsigned> E;
+  Hash_Table<unsigned, double, H, E, Chained_Storage, Power_Of_Two_Growth> P1{};
+  REQUIRE( P1.bucket_count() == 16 );
+  Check_Against_Map(P1, 20000, 3000);
+  REQUIRE( (P1.bucket_count() & (P1.bucket_count() - 1)) == 0 );
+
+  Hash_Table<unsigned, double, H, E, Linear_Probe_Storage, Power_Of_Two_Growth> P2{};
+  Check_Against_Map(P2, 20000, 3000);
+  REQUIRE( (P2.bucket_count() & (P2.bucket_count() - 1)) == 0 );
+
+  Hash_Table<unsigned, double, H, E, Robin_Hood_Storage, Power_Of_Two_Growth> P3{};
+  Check_Against_Map(P3, 20000, 3000);
+  REQUIRE( (P3.bucket_count() & (P3.bucket_count() - 1)) == 0 );
+
+  // Prime tables (the rehash should round 5000 up to a prime)
+  Hash_Table<unsigned, double, H, E, Chained_Storage, Prime_Growth> Q1{};
+  Q1.rehash(5000);
+  REQUIRE( Q1.bucket_count() == 6421 );
+  Check_Against_Map(Q1, 20000, 3000);
+
+  Hash_Table<unsigned, double, H, E, Linear_Probe_Storage, Prime_Growth> Q2{};
+  Check_Against_Map(Q2, 20000, 3000);
+
+  Hash_Table<unsigned, double, H, E, Robin_Hood_Storage, Prime_Growth> Q3{};
+  Check_Against_Map(Q3, 20000, 3000);
+} // TEST_CASE("Growth policy tests", "[Growth]") {
+
+
+
+/* Put N_Buckets keys that are all multiples of N_Buckets into a chained table
+with N_Buckets buckets (and a max load factor high enough that it never
+grows), and return the size of the biggest bucket. */
+template<typename Hash>
+unsigned Largest_Bucket(unsigned N_Buckets, const Hash& Hasher) {
+  Hash_Table<unsigned, double, Hash> H(N_Buckets, 100.0, Hasher);
+  for(unsigned i = 0; i < N_Buckets; i++) { H.insert(i*N_Buckets, i); }
+
+  REQUIRE( H.bucket_count() == N_Buckets );
+  REQUIRE( H.size() == N_Buckets );
+
+  unsigned Largest = 0;
+  for(unsigned i = 0; i < N_Buckets; i++) {
+    if(H.bucket_size(i) > Largest) { Largest = H.bucket_size(i); }
+  } // for(unsigned i = 0; i < N_Buckets; i++) {
+  return Largest;
+} // unsigned Largest_Bucket(unsigned N_Buckets, const Hash& Hasher) {
+
+
+TEST_CASE("Integer hash tests", "[Hash]") {
+  // With the identity hash, every key lands in bucket 0.
+  REQUIRE( Largest_Bucket(1001, std::hash<unsigned>()) == 1001 );
+
+  // The mixing hashes should spread the keys out.
+  REQUIRE( Largest_Bucket(1001, Fibonacci_Hash<unsigned>()) < 10 );
+  REQUIRE( Largest_Bucket(1001, Murmur_Hash<unsigned>()) < 10 );
+  REQUIRE( Largest_Bucket(1001, Wy_Hash<unsigned>()) < 10 );
+  REQUIRE( Largest_Bucket(1001, Murmur_Hash<unsigned>(12345)) < 10 );
+
+  // Different seeds should give different hashes.
+  REQUIRE( Murmur_Hash<unsigned>(1)(42) != Murmur_Hash<unsigned>(2)(42) );
+  REQUIRE( Wy_Hash<uint64_t>(1)(42) != Wy_Hash<uint64_t>(2)(42) );
+  REQUIRE( Fibonacci_Hash<uint64_t>(1)(42) != Fibonacci_Hash<uint64_t>(2)(42) );
+
+  // A seeded table should still work like any other table.
+  Hash_Table<unsigned, double, Wy_Hash<unsigned> > H(11, 1.0, Wy_Hash<unsigned>(987654321));
+  Check_Against_Map(H, 20000, 3000);
+} // TEST_CASE("Integer hash tests", "[Hash]") {
+
+
+
+TEST_CASE("Node pool tests", "[Node_Pool]") {
+  Node_Pool<unsigned, double> Pool;
+
+  // Allocate enough nodes to need several slabs.
+  const unsigned N_Nodes = 10000;
+  Item_Node<unsigned, double>* Nodes[N_Nodes];
+  for(unsigned i = 0; i < N_Nodes; i++) {
+    Nodes[i] = Pool.allocate(i, i + 0.5);
+    REQUIRE( Nodes[i]->getKey() == i );
+    REQUIRE( Nodes[i]->getValue() == i + 0.5 );
+    REQUIRE( Nodes[i]->getNext() == NULL );
+  } // for(unsigned i = 0; i < N_Nodes; i++) {
+
+  // Freed nodes should be handed out again (most recently freed first).
+  Item_Node<unsigned, double>* Freed = Nodes[500];
+  Pool.deallocate(Freed);
+  Nodes[500] = Pool.allocate(7, 7.5);
+  REQUIRE( Nodes[500] == Freed );
+  REQUIRE( Nodes[500]->getKey() == 7 );
+
+  for(unsigned i = 0; i < N_Nodes; i++) { Pool.deallocate(Nodes[i]); }
+
+  /* An item list can use the pool too (the list has to be emptied before it
+  is destroyed). */
+  Item_List<unsigned, double> List;
+  std::equal_to<unsigned> Equal;
+  REQUIRE( List.put(1, 1.5, Equal, Pool) == true );
+  REQUIRE( List.put(2, 2.5, Equal, Pool) == true );
+  REQUIRE( List.put(1, 3.5, Equal, Pool) == false );
+  REQUIRE( List.get(1) == 3.5 );
+  REQUIRE( List.remove(2, Equal, Pool) == true );
+  REQUIRE( List.size() == 1 );
+  List.clear(Pool);
+  REQUIRE( List.size() == 0 );
+
+  /* A table with values that aren't trivially destructible. The table has to
+  destroy the values of its pooled nodes (the leak checker will complain if
+  it doesn't). */
+  Hash_Table<unsigned, std::string> H{};
+  for(unsigned i = 0; i < 1000; i++) { H.insert(i, std::string(50, 'a' + i % 26)); }
+  for(unsigned i = 0; i < 1000; i += 2) { H.remove(i); }
+  for(unsigned i = 0; i < 500; i++) { H.insert(i + 1000, std::string(50, 'z')); }
+  REQUIRE( H.size() == 1000 );
+  REQUIRE( H.search(1) == std::string(50, 'b') );
+  REQUIRE( H.search(1499) == std::string(50, 'z') );
+} // TEST_CASE("Node pool tests", "[Node_Pool]") {
+
+
+
+// Check find, contains, and get_or.
+template<typename Table>
+void Check_Non_Throwing_Lookups() {
+  Table H{};
+  for(unsigned i = 0; i < 100; i++) { H.insert(i*3, i + 0.5); }
+
+  for(unsigned key = 0; key < 300; key++) {
+    const Table& Const_H = H;
+    if(key % 3 == 0) {
+      REQUIRE( H.find(key) != NULL );
+      REQUIRE( *Const_H.find(key) == key/3 + 0.5 );
+      REQUIRE( H.contains(key) == true );
+      REQUIRE( H.get_or(key, -1.0) == key/3 + 0.5 );
+    } // if(key % 3 == 0) {
+    else {
+      REQUIRE( H.find(key) == NULL );
+      REQUIRE( Const_H.find(key) == NULL );
+      REQUIRE( H.contains(key) == false );
+      REQUIRE( H.get_or(key, -1.0) == -1.0 );
+    } // else
+  } // for(unsigned key = 0; key < 300; key++) {
+
+  // The pointer from find can be used to update the value in place.
+  *H.find(3) = 12.5;
+  REQUIRE( H.search(3) == 12.5 );
+} // void Check_Non_Throwing_Lookups() {
+
+
+TEST_CASE("Non-throwing lookup tests", "[Hash_Table]") {
+  CHECK_EVERY_ENGINE(Check_Non_Throwing_Lookups, unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>);
+
+  // Item_List's find should return the node (or NULL).
+  Item_List<unsigned, double> List;
+  List.put(4, 1.5);
+  REQUIRE( List.find(4) != NULL );
+  REQUIRE( List.find(4)->getValue() == 1.5 );
+  REQUIRE( List.find(5) == NULL );
+} // TEST_CASE("Non-throwing lookup tests", "[Hash_Table]") {
+
+
+
+/* A value that counts how many times values have been copied. Used to check
+that lookups don't copy values. */
+struct Counted_Value {
+  static unsigned N_Copies;
+  double x;
+
+  Counted_Value(double x = 0) : x(x) {}
+  Counted_Value(const Counted_Value& Other) : x(Other.x) { N_Copies++; }
+  Counted_Value& operator=(const Counted_Value& Other) { x = Other.x; N_Copies++; return *this; }
+}; // struct Counted_Value {
+unsigned Counted_Value::N_Copies = 0;
+
+std::ostream& operator<<(std::ostream& os, const Counted_Value& Value) { return os << Value.x; }
+
+
+// Check that search and modify work on the value in the table, without copying it.
+template<typename Table>
+void Check_In_Place_Access() {
+  Table H{};
+  for(unsigned i = 0; i < 100; i++) { H.insert(i, Counted_Value(i)); }
+
+  Counted_Value::N_Copies = 0;
+  for(unsigned i = 0; i < 100; i++) { REQUIRE( H.search(i).x == i ); }
+
+  // search returns a reference into the table, so we can update through it.
+  H.search(5).x = 50;
+  REQUIRE( H.search(5).x == 50 );
+
+  // modify updates in place, and tells us if the key was in the table.
+  REQUIRE( H.modify(6, [](Counted_Value& Value) { Value.x *= 10; }) == true );
+  REQUIRE( H.modify(1000, [](Counted_Value& Value) { Value.x = -1; }) == false );
+  REQUIRE( H.search(6).x == 60 );
+  REQUIRE( H.contains(1000) == false );
+
+  REQUIRE( Counted_Value::N_Copies == 0 );
+  REQUIRE_THROWS_AS( H.search(1000), Invalid_Key );
+} // void Check_In_Place_Access() {
+
+
+TEST_CASE("In place access tests", "[Hash_Table]") {
+  CHECK_EVERY_ENGINE(Check_In_Place_Access, unsigned, Counted_Value, std::hash<unsigned>, std::equal_to<unsigned>);
+
+  // Item nodes and lists also hand out references.
+  Item_List<unsigned, Counted_Value> List;
+  List.put(1, Counted_Value(1.5));
+  Counted_Value::N_Copies = 0;
+  List.get(1).x = 2.5;
+  REQUIRE( List.get(1).x == 2.5 );
+  REQUIRE( List.find(1)->getValue().x == 2.5 );
+  REQUIRE( Counted_Value::N_Copies == 0 );
+} // TEST_CASE("In place access tests", "[Hash_Table]") {
+
+
+
+/* A value that can't be default constructed or copied (only moved). Tables
+have to construct these in place (or move them in). */
+struct Move_Only_Value {
+  std::unique_ptr<int> Product;
+
+  Move_Only_Value(int a, int b) : Product(new int(a*b)) {}
+}; // struct Move_Only_Value {
+
+
+// Check try_emplace, emplace, and insert_or_assign.
+template<typename Table>
+void Check_Emplace() {
+  Table H{};
+
+  // try_emplace only builds a value if the key is new.
+  std::pair<Move_Only_Value*, bool> Result = H.try_emplace(1, 2, 3);
+  REQUIRE( Result.second == true );
+  REQUIRE( *Result.first->Product == 6 );
+  Result = H.try_emplace(1, 4, 5);
+  REQUIRE( Result.second == false );
+  REQUIRE( *Result.first->Product == 6 );
+
+  // If the key is already there, an rvalue argument isn't moved from.
+  Move_Only_Value Value(7, 8);
+  REQUIRE( H.try_emplace(1, std::move(Value)).second == false );
+  REQUIRE( Value.Product != nullptr );
+
+  REQUIRE( H.emplace(2, 3, 3) == true );
+  REQUIRE( H.emplace(2, 4, 4) == false );
+  REQUIRE( *H.search(2).Product == 9 );
+
+  // insert_or_assign moves its value in, whether or not the key is new.
+  REQUIRE( H.insert_or_assign(2, std::move(Value)).second == false );
+  REQUIRE( *H.search(2).Product == 56 );
+  REQUIRE( Value.Product == nullptr );
+  REQUIRE( H.insert_or_assign(3, Move_Only_Value(1, 1)).second == true );
+  REQUIRE( H.size() == 3 );
+
+  // Enough items to grow the table (and, for Robin Hood, displace items).
+  for(int i = 0; i < 1000; i++) { H.try_emplace(i, i, 2); }
+  REQUIRE( H.size() == 1000 );
+  REQUIRE( *H.search(1).Product == 6 );
+  REQUIRE( *H.search(2).Product == 56 );
+  REQUIRE( *H.search(3).Product == 1 );
+  for(int i = 4; i < 1000; i++) { REQUIRE( *H.search(i).Product == 2*i ); }
+
+  for(int i = 0; i < 1000; i += 2) { H.remove(i); }
+  REQUIRE( H.size() == 500 );
+  for(int i = 5; i < 1000; i += 2) { REQUIRE( *H.search(i).Product == 2*i ); }
+} // void Check_Emplace() {
+
+
+TEST_CASE("Emplace tests", "[Hash_Table]") {
+  CHECK_EVERY_ENGINE(Check_Emplace, int, Move_Only_Value, std::hash<int>, std::equal_to<int>);
+
+  // Item lists can build values in place too.
+  Item_List<int, Move_Only_Value> List;
+  std::equal_to<int> Equal;
+  Heap_Node_Allocator<int, Move_Only_Value> Heap;
+  REQUIRE( List.try_emplace(Equal, Heap, 1, 2, 3).second == true );
+  REQUIRE( List.try_emplace(Equal, Heap, 1, 4, 5).second == false );
+  REQUIRE( *List.get(1).Product == 6 );
+
+  // Strings can be moved in as keys.
+  Hash_Table<std::string, std::string> Strings{};
+  std::string Key(100, 'k');
+  REQUIRE( Strings.emplace(std::move(Key), 3, 'v') == true );
+  REQUIRE( Strings.search(std::string(100, 'k')) == "vvv" );
+} // TEST_CASE("Emplace tests", "[Hash_Table]") {
+
+
+
+// Count and sum with upsert and compute, and check the results against std::map.
+template<typename Table>
+void Check_Upsert() {
+  Table Counts{}, Sums{};
+  std::map<unsigned, unsigned> Map_Counts;
+  std::map<unsigned, unsigned> Map_Sums;
+
+  srand(2);
+  for(unsigned i = 0; i < 5000; i++) {
+    unsigned key = rand() % 300;
+    unsigned Amount = rand() % 10;
+
+    bool Is_New = (Map_Counts.count(key) == 0);
+    REQUIRE( Counts.compute(key, [](unsigned& Count) { Count++; }) == Is_New );
+    REQUIRE( Sums.upsert(key, Amount, [](unsigned& Sum, unsigned n) { Sum += n; }) == Is_New );
+    Map_Counts[key]++;
+    Map_Sums[key] += Amount;
+  } // for(unsigned i = 0; i < 5000; i++) {
+
+  REQUIRE( Counts.size() == Map_Counts.size() );
+  REQUIRE( Sums.size() == Map_Sums.size() );
+  for(std::map<unsigned, unsigned>::iterator It = Map_Counts.begin(); It != Map_Counts.end(); ++It) {
+    REQUIRE( Counts.search(It->first) == It->second );
+    REQUIRE( Sums.search(It->first) == Map_Sums[It->first] );
+  } // for(std::map<unsigned, unsigned>::iterator It = Map_Counts.begin(); It != Map_Counts.end(); ++It) {
+} // void Check_Upsert() {
+
+
+TEST_CASE("Upsert tests", "[Hash_Table]") {
+  CHECK_EVERY_ENGINE(Check_Upsert, unsigned, unsigned, std::hash<unsigned>, std::equal_to<unsigned>);
+
+  // Item lists
+  Item_List<unsigned, double> List;
+  REQUIRE( List.upsert(1, 1.5, [](double& Sum, double x) { Sum += x; }) == true );
+  REQUIRE( List.upsert(1, 2.0, [](double& Sum, double x) { Sum += x; }) == false );
+  REQUIRE( List.get(1) == 3.5 );
+  REQUIRE( List.compute(2, [](double& x) { x += 4; }) == true );
+  REQUIRE( List.compute(2, [](double& x) { x *= 2; }) == false );
+  REQUIRE( List.get(2) == 8 );
+  REQUIRE( List.size() == 2 );
+} // TEST_CASE("Upsert tests", "[Hash_Table]") {
+
+
+
+// Check reserve and range inserts.
+template<typename Table>
+void Check_Reserve() {
+  // After reserve(N), inserting N items shouldn't rehash.
+  Table H{};
+  H.reserve(1000);
+  unsigned N_Buckets = H.bucket_count();
+  for(unsigned i = 0; i < 1000; i++) { H.insert(i, i); }
+  REQUIRE( H.bucket_count() == N_Buckets );
+  REQUIRE( H.load_factor() <= H.max_load_factor() );
+
+  // Reserving less than we already have does nothing.
+  H.reserve(10);
+  REQUIRE( H.bucket_count() == N_Buckets );
+
+  // Range inserts. If a key shows up more than once, the last value wins.
+  std::vector< std::pair<unsigned, double> > Items;
+  for(unsigned i = 0; i < 3000; i++) { Items.push_back(std::make_pair(i % 2000, (double)i)); }
+
+  Table H2{};
+  H2.insert(Items.begin(), Items.end());
+  REQUIRE( H2.size() == 2000 );
+  for(unsigned i = 0; i < 1000; i++) { REQUIRE( H2.search(i) == i + 2000 ); }
+  for(unsigned i = 1000; i < 2000; i++) { REQUIRE( H2.search(i) == i ); }
+
+  // Range inserts update items that are already in the table.
+  std::map<unsigned, double> Map;
+  for(unsigned i = 0; i < 4000; i += 2) { Map[i] = -1.0*i; }
+  H2.insert(Map.begin(), Map.end());
+  REQUIRE( H2.size() == 3000 );
+  for(unsigned i = 0; i < 4000; i += 2) { REQUIRE( H2.search(i) == -1.0*i ); }
+  for(unsigned i = 1; i < 2000; i += 2) { REQUIRE( H2.search(i) == (i < 1000 ? i + 2000 : i) ); }
+} // void Check_Reserve() {
+
+
+TEST_CASE("Reserve tests", "[Hash_Table]") {
+  typedef std::hash<unsigned> H;
+  typedef std::equal_to<unsigned> E;
+  CHECK_EVERY_ENGINE(Check_Reserve, unsigned, double, H, E);
+  Check_Reserve< Hash_Table<unsigned, double, H, E, Chained_Storage, Power_Of_Two_Growth> >();
+
+  // Swiss tables also need room left over from deleted slots.
+  Hash_Table<unsigned, double, H, E, Swiss_Storage> Swiss{};
+  for(unsigned i = 0; i < 100; i++) { Swiss.insert(i, i); }
+  for(unsigned i = 0; i < 100; i++) { Swiss.remove(i); }
+  Swiss.reserve(100);
+  unsigned N_Slots = Swiss.bucket_count();
+  for(unsigned i = 1000; i < 1100; i++) { Swiss.insert(i, i); }
+  REQUIRE( Swiss.bucket_count() == N_Slots );
+
+  // Node pools can be reserved too: nothing here should need a new slab.
+  Node_Pool<unsigned, double> Pool;
+  Pool.reserve(100);
+  Item_Node<unsigned, double>* Nodes[100];
+  for(unsigned i = 0; i < 100; i++) { Nodes[i] = Pool.allocate(i, i); }
+  for(unsigned i = 1; i < 100; i++) { REQUIRE( Nodes[i] == Nodes[i - 1] + 1 ); }
+  for(unsigned i = 0; i < 100; i++) { Pool.deallocate(Nodes[i]); }
+} // TEST_CASE("Reserve tests", "[Hash_Table]") {
+
+
+
+// Check batched lookups against one at a time lookups.
+template<typename Table>
+void Check_Search_Batch() {
+  Table H{};
+  for(unsigned i = 0; i < 1000; i += 3) { H.insert(i, 0.5*i); }
+
+  // A batch that isn't a multiple of the group size or of 64.
+  const unsigned N = 1001;
+  std::vector<unsigned> Keys(N);
+  for(unsigned i = 0; i < N; i++) { Keys[i] = (i*7) % 1100; }
+
+  std::vector<double> Out(N, -1);
+  std::vector<uint64_t> Found_Mask((N + 63)/64, ~(uint64_t)0);
+  unsigned N_Found = H.search_batch(Keys.data(), N, Out.data(), Found_Mask.data());
+
+  unsigned N_Expected = 0;
+  for(unsigned i = 0; i < N; i++) {
+    bool Found = (Found_Mask[i/64] >> (i % 64)) & 1;
+    REQUIRE( Found == H.contains(Keys[i]) );
+    if(Found == true) {
+      REQUIRE( Out[i] == 0.5*Keys[i] );
+      N_Expected++;
+    } // if(Found == true) {
+    else { REQUIRE( Out[i] == -1 ); }
+  } // for(unsigned i = 0; i < N; i++) {
+  REQUIRE( N_Found == N_Expected );
+
+  // An empty batch does nothing.
+  REQUIRE( H.search_batch(Keys.data(), 0, Out.data(), Found_Mask.data()) == 0 );
+} // void Check_Search_Batch() {
+
+
+TEST_CASE("Batch search tests", "[Hash_Table]") {
+  CHECK_EVERY_ENGINE(Check_Search_Batch, unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>);
+
+  // Batches also work in the middle of an incremental rehash.
+  Hash_Table<unsigned, double> Incremental{};
+  Incremental.rehash_step(1);
+  for(unsigned i = 0; i < 2000; i++) { Incremental.insert(i, 0.5*i); }
+  REQUIRE( Incremental.rehashing() == true );
+  std::vector<unsigned> Keys(2000);
+  for(unsigned i = 0; i < 2000; i++) { Keys[i] = 1999 - i; }
+  std::vector<double> Out(2000);
+  std::vector<uint64_t> Found_Mask(2000/64 + 1);
+  REQUIRE( Incremental.search_batch(Keys.data(), 2000, Out.data(), Found_Mask.data()) == 2000 );
+  for(unsigned i = 0; i < 2000; i++) { REQUIRE( Out[i] == 0.5*Keys[i] ); }
+} // TEST_CASE("Batch search tests", "[Hash_Table]") {
+
+
+
+#if defined(HASH_TABLE_COROUTINES)
+TEST_CASE("Interleaved search tests", "[Hash_Table]") {
+  Hash_Table<unsigned, double> H{};
+  for(unsigned i = 0; i < 5000; i += 3) { H.insert(i, 0.5*i); }
+
+  // Long chains, so that lookups suspend more than once.
+  H.max_load_factor(8);
+  H.rehash(100);
+
+  const unsigned N = 5001;
+  std::vector<unsigned> Keys(N);
+  for(unsigned i = 0; i < N; i++) { Keys[i] = (i*7) % 5500; }
+
+  // Try a few different numbers of lookups in flight.
+  for(unsigned N_In_Flight = 1; N_In_Flight <= 32; N_In_Flight *= 4) {
+    std::vector<double> Out(N, -1);
+    std::vector<uint64_t> Found_Mask((N + 63)/64, ~(uint64_t)0);
+    unsigned N_Found = H.search_interleaved(Keys.data(), N, Out.data(), Found_Mask.data(), N_In_Flight);
+
+    unsigned N_Expected = 0;
+    for(unsigned i = 0; i < N; i++) {
+      bool Found = (Found_Mask[i/64] >> (i % 64)) & 1;
+      REQUIRE( Found == H.contains(Keys[i]) );
+      if(Found == true) {
+        REQUIRE( Out[i] == 0.5*Keys[i] );
+        N_Expected++;
+      } // if(Found == true) {
+      else { REQUIRE( Out[i] == -1 ); }
+    } // for(unsigned i = 0; i < N; i++) {
+    REQUIRE( N_Found == N_Expected );
+  } // for(unsigned N_In_Flight = 1; N_In_Flight <= 32; N_In_Flight *= 4) {
+
+  // No lookups in flight means one, not none (which would miss every key).
+  std::vector<double> One_Out(N, -1);
+  std::vector<uint64_t> One_Found_Mask((N + 63)/64);
+  REQUIRE( H.search_interleaved(Keys.data(), N, One_Out.data(), One_Found_Mask.data(), 0) ==
+           H.search_interleaved(Keys.data(), N, One_Out.data(), One_Found_Mask.data(), 1) );
+  REQUIRE( H.search_interleaved(Keys.data(), N, One_Out.data(), One_Found_Mask.data(), 0) > 0 );
+
+  // Lookups find keys in both bucket arrays while an incremental rehash is in progress.
+  Hash_Table<unsigned, double> Incremental{};
+  Incremental.rehash_step(1);
+  for(unsigned i = 0; i < 2000; i++) { Incremental.insert(i, 0.5*i); }
+  REQUIRE( Incremental.rehashing() == true );
+  std::vector<unsigned> All_Keys(2000);
+  for(unsigned i = 0; i < 2000; i++) { All_Keys[i] = 1999 - i; }
+  std::vector<double> Out(2000);
+  std::vector<uint64_t> Found_Mask(2000/64 + 1);
+  REQUIRE( Incremental.search_interleaved(All_Keys.data(), 2000, Out.data(), Found_Mask.data()) == 2000 );
+  for(unsigned i = 0; i < 2000; i++) { REQUIRE( Out[i] == 0.5*All_Keys[i] ); }
+  REQUIRE( Incremental.size() == 2000 );
+  REQUIRE( Incremental.rehashing() == true );
+} // TEST_CASE("Interleaved search tests", "[Hash_Table]") {
+#endif
+
+
+
+TEST_CASE("Unrolled chains tests", "[Unrolled_Storage]") {
+  // Chunks are cache line sized and aligned, and hold as many items as fit.
+  REQUIRE( Unrolled_Chunk<unsigned, double>::Capacity == 4 );
+  REQUIRE( sizeof(Unrolled_Chunk<unsigned, double>) == 64 );
+  REQUIRE( alignof(Unrolled_Chunk<unsigned, double>) == 64 );
+  REQUIRE( Unrolled_Chunk<uint64_t, uint64_t>::Capacity == 3 );
+  REQUIRE( Unrolled_Chunk<std::string, std::string>::Capacity == 1 );
+
+  typedef Hash_Table<unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>, Unrolled_Storage> Table;
+  Table H{};
+  REQUIRE( H.max_load_factor() == 2.0f );
+
+  // Keys 0, 11, 22, ... all land in bucket 0, so they need two chunks.
+  for(unsigned i = 0; i < 6; i++) { H.insert(11*i, i + 0.5); }
+  REQUIRE( H.bucket_count() == 11 );
+  REQUIRE( H.bucket_size(0) == 6 );
+  for(unsigned i = 0; i < 6; i++) { REQUIRE( H.search(11*i) == i + 0.5 ); }
+
+  // Removing items moves the last item into the hole.
+  H.remove(0);
+  H.remove(33);
+  REQUIRE( H.bucket_size(0) == 4 );
+  REQUIRE_THROWS( H.search(0) );
+  REQUIRE_THROWS( H.search(33) );
+  REQUIRE( H.search(11) == 1.5 );
+  REQUIRE( H.search(22) == 2.5 );
+  REQUIRE( H.search(44) == 4.5 );
+  REQUIRE( H.search(55) == 5.5 );
+  for(unsigned i = 0; i < 6; i++) { H.remove(11*i); }
+  REQUIRE( H.bucket_size(0) == 0 );
+  REQUIRE( H.size() == 0 );
+
+  // Check the table against a std::map, with short and then long chains.
+  Check_Against_Map(H, 50000, 5000);
+  Table H2(11, 16.0);
+  Check_Against_Map(H2, 50000, 5000);
+  REQUIRE( H2.load_factor() > 4 );
+} // TEST_CASE("Unrolled chains tests", "[Unrolled_Storage]") {
+
+
+
+TEST_CASE("Inline chains tests", "[Inline_Chained_Storage]") {
+  typedef Hash_Table<unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>, Inline_Chained_Storage> Table;
+  Table H{};
+  REQUIRE( H.max_load_factor() == 1.0f );
+
+  // Keys 0, 11 and 22 all land in bucket 0: 0 is inline, the others overflow.
+  H.insert(0, 0.5);
+  H.insert(11, 1.5);
+  H.insert(22, 2.5);
+  H.insert(1, 3.5);
+  REQUIRE( H.bucket_count() == 11 );
+  REQUIRE( H.bucket_size(0) == 3 );
+  REQUIRE( H.bucket_size(1) == 1 );
+  REQUIRE( H.bucket_size(2) == 0 );
+
+  // Removing the inline item moves an overflow item inline.
+  H.remove(0);
+  REQUIRE( H.bucket_size(0) == 2 );
+  REQUIRE_THROWS( H.search(0) );
+  REQUIRE( H.search(11) == 1.5 );
+  REQUIRE( H.search(22) == 2.5 );
+  H.remove(22);
+  H.remove(11);
+  REQUIRE( H.bucket_size(0) == 0 );
+  REQUIRE( H.size() == 1 );
+  REQUIRE( H.search(1) == 3.5 );
+
+  // Check the table against a std::map, with short and then long chains.
+  Check_Against_Map(H, 50000, 5000);
+  Table H2(11, 8.0);
+  Check_Against_Map(H2, 50000, 5000);
+  REQUIRE( H2.load_factor() > 2 );
+
+  // Values that aren't trivially destructible (the leak checker will complain if they aren't destroyed).
+  Hash_Table<unsigned, std::string, std::hash<unsigned>, std::equal_to<unsigned>, Inline_Chained_Storage> Strings{};
+  for(unsigned i = 0; i < 1000; i++) { Strings.insert(i, std::string(50, 'a' + i % 26)); }
+  for(unsigned i = 0; i < 1000; i += 2) { Strings.remove(i); }
+  REQUIRE( Strings.search(1) == std::string(50, 'b') );
+} // TEST_CASE("Inline chains tests", "[Inline_Chained_Storage]") {
+
+
+
+// Key equality (for strings) that counts how many times it's called.
+struct Counting_Equal {
+  static unsigned N_Calls;
+  bool operator()(const std::string& a, const std::string& b) const {
+    N_Calls++;
+    return a == b;
+  } // bool operator()(const std::string& a, const std::string& b) const {
+}; // struct Counting_Equal {
+
+unsigned Counting_Equal::N_Calls = 0;
+
+TEST_CASE("Stored hash tests", "[Chained_Storage]") {
+  // A list given hashes only compares keys whose hashes match.
+  Item_List<std::string, double, Counting_Equal> List;
+  Node_Pool<std::string, double> Pool;
+  List.try_emplace(1, Counting_Equal(), Pool, std::string("one"), 1.0);
+  List.try_emplace(2, Counting_Equal(), Pool, std::string("two"), 2.0);
+  REQUIRE( List.first()->getHash() == 1 );
+
+  Counting_Equal::N_Calls = 0;
+  REQUIRE( List.find("two", 2, Counting_Equal())->getValue() == 2.0 );
+  REQUIRE( List.find("two", 3, Counting_Equal()) == NULL );
+  REQUIRE( Counting_Equal::N_Calls == 1 );
+  REQUIRE( List.remove("one", 1, Counting_Equal(), Pool) == true );
+  REQUIRE( List.size() == 1 );
+  List.clear(Pool);
+
+  /* Long chains of string keys: each hit should compare exactly one pair of
+  keys (distinct strings almost never share a full hash), and misses none. */
+  Hash_Table<std::string, unsigned, std::hash<std::string>, Counting_Equal> H(11, 50.0);
+  for(unsigned i = 0; i < 2000; i++) { H.insert(std::string(40, 'k') + std::to_string(i), i); }
+  REQUIRE( H.load_factor() > 10 );
+
+  Counting_Equal::N_Calls = 0;
+  for(unsigned i = 0; i < 2000; i++) { REQUIRE( *H.find(std::string(40, 'k') + std::to_string(i)) == i ); }
+  for(unsigned i = 2000; i < 4000; i++) { REQUIRE( H.contains(std::string(40, 'k') + std::to_string(i)) == false ); }
+  REQUIRE( Counting_Equal::N_Calls == 2000 );
+
+  // Rehashing (all at once, or incrementally) uses the stored hashes.
+  H.rehash(4001);
+  REQUIRE( H.bucket_count() >= 4001 );
+  H.rehash_step(4);
+  H.max_load_factor(0.25);
+  REQUIRE( H.rehashing() == true );
+  for(unsigned i = 0; i < 2000; i += 2) { H.remove(std::string(40, 'k') + std::to_string(i)); }
+  REQUIRE( H.size() == 1000 );
+  for(unsigned i = 1; i < 2000; i += 2) { REQUIRE( H.search(std::string(40, 'k') + std::to_string(i)) == i ); }
+} // TEST_CASE("Stored hash tests", "[Chained_Storage]") {
+
+
+
+TEST_CASE("Treeify tests", "[Chained_Storage]") {
+  // Keys that are multiples of 11 all land in bucket 0 (and don't grow the table).
+  Hash_Table<unsigned, double> H(11, 100.0);
+  REQUIRE( H.Treeify_Threshold == 8 );
+  for(unsigned i = 0; i < 8; i++) { H.insert(11*i, i + 0.5); }
+  REQUIRE( H.treeified(0) == false );
+
+  // The next insert finds the bucket too long, and treeifies it.
+  for(unsigned i = 8; i < 200; i++) { H.insert(11*i, i + 0.5); }
+  REQUIRE( H.treeified(0) == true );
+  REQUIRE( H.treeified(1) == false );
+  REQUIRE( H.bucket_size(0) == 200 );
+  for(unsigned i = 0; i < 200; i++) { REQUIRE( H.search(11*i) == i + 0.5 ); }
+  REQUIRE( H.contains(11*200) == false );
+  REQUIRE( H.contains(1) == false );
+
+  // Updates and removes go through the index too.
+  H.insert(11*5, 100.0);
+  REQUIRE( H.search(11*5) == 100.0 );
+  H.remove(11*200);
+  REQUIRE( H.bucket_size(0) == 200 );
+
+  // Shrinking the bucket to 6 items turns it back into a list.
+  for(unsigned i = 0; i < 193; i++) { H.remove(11*i); }
+  REQUIRE( H.treeified(0) == true );
+  H.remove(11*193);
+  REQUIRE( H.treeified(0) == false );
+  REQUIRE( H.size() == 6 );
+  for(unsigned i = 194; i < 200; i++) { REQUIRE( H.search(11*i) == i + 0.5 ); }
+
+  // Rehashing drops every index (they're rebuilt by later inserts).
+  for(unsigned i = 0; i < 50; i++) { H.insert(11*i, i + 0.5); }
+  REQUIRE( H.treeified(0) == true );
+  H.rehash(23);
+  REQUIRE( H.treeified(0) == false );
+  for(unsigned i = 194; i < 200; i++) { REQUIRE( H.search(11*i) == i + 0.5 ); }
+
+  /* Different keys whose hashes are all the same (31x + y = 1000): treeified
+  lookups still have to find the right one. */
+  Hash_Table<Point, int, Point_Hash, Point_Equal> P(11, 1000.0);
+  for(int x = 0; x < 100; x++) { P.insert(Point{x, 1000 - 31*x}, x); }
+  REQUIRE( P.treeified(P.bucket(Point{0, 1000})) == true );
+  for(int x = 0; x < 100; x++) { REQUIRE( P.search(Point{x, 1000 - 31*x}) == x ); }
+  REQUIRE( P.contains(Point{100, 1000 - 31*101}) == false );
+  for(int x = 0; x < 100; x += 3) { P.remove(Point{x, 1000 - 31*x}); }
+  for(int x = 1; x < 100; x += 3) { REQUIRE( P.search(Point{x, 1000 - 31*x}) == x ); }
+
+  // Check long (treeified) chains against a std::map, with and without incremental rehashing.
+  Hash_Table<unsigned, double> H2(11, 40.0);
+  Check_Against_Map(H2, 50000, 5000);
+  Hash_Table<unsigned, double> H3(11, 40.0);
+  H3.rehash_step(2);
+  Check_Against_Map(H3, 50000, 5000);
+} // TEST_CASE("Treeify tests", "[Chained_Storage]") {
+
+
+
+
+/* Run Fn(t) on N_Threads threads at once (t = 0, ..., N_Threads - 1), and
+wait for all of them to finish. */
+template<typename Function>
+void Run_Threads(unsigned N_Threads, Function Fn) {
+  std::vector<std::thread> Threads;
+  for(unsigned t = 0; t < N_Threads; t++) { Threads.push_back(std::thread(Fn, t)); }
+  for(unsigned t = 0; t < N_Threads; t++) { Threads[t].join(); }
+} // void Run_Threads(unsigned N_Threads, Function Fn) {
+
+
+/* Check a concurrent table: first on one thread (against a std::map), then
+with several threads inserting, counting, and removing at once. The table
+type is a template parameter so that we can test every concurrent table. */
+template<typename Table>
+void Check_Concurrent() {
+  Table H1{};
+  Check_Against_Map(H1, 50000, 5000);
+  REQUIRE( H1.get_or(5000, -1.0) == -1.0 );
+
+  /* Each thread inserts its own keys, and every thread counts the same
+  shared keys (so the counts check that updates aren't lost). */
+  const unsigned N_Threads = 8, N_Keys = 20000, N_Shared = 100;
+  Table H2{};
+  Run_Threads(N_Threads, [&](unsigned t) {
+    for(unsigned i = 0; i < N_Keys; i++) {
+      H2.insert(1000000 + t*N_Keys + i, i + 0.5);
+      H2.compute(i % N_Shared, [](double& Count) { Count++; });
+    } // for(unsigned i = 0; i < N_Keys; i++) {
+  }); // Run_Threads(N_Threads, [&](unsigned t) {
+
+  REQUIRE( H2.size() == N_Threads*N_Keys + N_Shared );
+  for(unsigned i = 0; i < N_Shared; i++) { REQUIRE( H2.search(i) == N_Threads*N_Keys/N_Shared ); }
+  for(unsigned t = 0; t < N_Threads; t++) {
+    for(unsigned i = 0; i < N_Keys; i += 97) { REQUIRE( H2.search(1000000 + t*N_Keys + i) == i + 0.5 ); }
+  } // for(unsigned t = 0; t < N_Threads; t++) {
+
+  /* Half of the threads remove their keys while the other half look theirs
+  up (and check that they always find them). */
+  std::vector<char> Thread_Ok(N_Threads, 1);
+  Run_Threads(N_Threads, [&](unsigned t) {
+    for(unsigned i = 0; i < N_Keys; i++) {
+      unsigned key = 1000000 + t*N_Keys + i;
+      if(t % 2 == 0) { H2.remove(key); }
+      else {
+        double Value;
+        if(H2.find(key, Value) == false || Value != i + 0.5) { Thread_Ok[t] = 0; }
+      } // else
+    } // for(unsigned i = 0; i < N_Keys; i++) {
+  }); // Run_Threads(N_Threads, [&](unsigned t) {
+
+  for(unsigned t = 0; t < N_Threads; t++) { REQUIRE( Thread_Ok[t] == 1 ); }
+  REQUIRE( H2.size() == N_Threads*N_Keys/2 + N_Shared );
+  REQUIRE( H2.contains(1000000) == false );
+  REQUIRE( H2.contains(1000000 + N_Keys) == true );
+} // void Check_Concurrent() {
+
+
+TEST_CASE("Striped hash table tests", "[Striped_Hash_Table]") {
+  // The stripe count is rounded up to a power of two, and keys are spread over every stripe.
+  Striped_Hash_Table<unsigned, double> H(10);
+  REQUIRE( H.stripe_count() == 16 );
+  std::vector<unsigned> Stripe_Sizes(16, 0);
+  for(unsigned i = 0; i < 1600; i++) { Stripe_Sizes[H.stripe(i)]++; }
+  for(unsigned i = 0; i < 16; i++) { REQUIRE( Stripe_Sizes[i] > 50 ); }
+
+  Striped_Hash_Table<unsigned, double> One(1);
+  REQUIRE( One.stripe_count() == 1 );
+  One.insert(1, 2.5);
+  REQUIRE( One.search(1) == 2.5 );
+  REQUIRE_THROWS_AS( One.search(2), Invalid_Key );
+
+  Check_Concurrent< Striped_Hash_Table<unsigned, double> >();
+  Check_Concurrent< Striped_Hash_Table<unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>, Swiss_Storage, Power_Of_Two_Growth> >();
+} // TEST_CASE("Striped hash table tests", "[Striped_Hash_Table]") {
+
+
+
+TEST_CASE("Lock-free read tests", "[Lock_Free_Read_Hash_Table]") {
+  Check_Concurrent< Lock_Free_Read_Hash_Table<unsigned, double> >();
+
+  Lock_Free_Read_Hash_Table<unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>, Power_Of_Two_Growth> H(16, 1.0, 10);
+  REQUIRE( H.stripe_count() == 16 );
+  REQUIRE( H.bucket_count() == 16 );
+
+  /* Readers look up keys 0-999 (which are always in the table) while writers
+  keep updating them (to 2*key or 2*key + 1) and add and remove other keys
+  (growing the table several times). Readers should always find the stable
+  keys, with one of their two values. */
+  const unsigned N_Stable = 1000, N_Readers = 4, N_Writers = 4;
+  for(unsigned key = 0; key < N_Stable; key++) { H.insert(key, 2.0*key); }
+
+  std::atomic<unsigned> N_Writers_Done(0);
+  std::vector<char> Reader_Ok(N_Readers, 1);
+  Run_Threads(N_Readers + N_Writers, [&](unsigned t) {
+    if(t < N_Writers) {
+      for(unsigned i = 0; i < 20000; i++) {
+        unsigned key = (i*7 + t) % N_Stable;
+        H.insert(key, 2.0*key + (i % 2));
+        H.compute(key, [key](double& Value) { Value = (Value == 2.0*key) ? 2.0*key + 1 : 2.0*key; });
+
+        unsigned Extra = 1000000 + t*20000 + i;
+        H.insert(Extra, 1.0);
+        if(i % 2 == 0) { H.remove(Extra); }
+      } // for(unsigned i = 0; i < 20000; i++) {
+      N_Writers_Done++;
+    } // if(t < N_Writers) {
+    else {
+      unsigned r = t - N_Writers;
+      while(N_Writers_Done.load() < N_Writers) {
+        for(unsigned key = 0; key < N_Stable; key++) {
+          double Value = -1;
+          if(H.find(key, Value) == false || (Value != 2.0*key && Value != 2.0*key + 1)) { Reader_Ok[r] = 0; }
+        } // for(unsigned key = 0; key < N_Stable; key++) {
+      } // while(N_Writers_Done.load() < N_Writers) {
+    } // else
+  }); // Run_Threads(N_Readers + N_Writers, [&](unsigned t) {
+
+  for(unsigned r = 0; r < N_Readers; r++) { REQUIRE( Reader_Ok[r] == 1 ); }
+  REQUIRE( H.size() == N_Stable + N_Writers*10000 );
+  REQUIRE( H.bucket_count() >= H.size() );
+  REQUIRE( H.contains(1000000 + 1) == true );
+  REQUIRE( H.contains(1000000) == false );
+
+  // With nobody reading, everything that was retired can be freed.
+  for(unsigned i = 0; i < 3; i++) { H.epochs().collect(); }
+  REQUIRE( H.epochs().retired_count() == 0 );
+
+  /* Growing is spread over the writers: each write migrates 64 buckets, so
+  migrating 1024 buckets takes 16 writes, and every item can be found (and
+  updated) the whole time. */
+  Lock_Free_Read_Hash_Table<unsigned, double, std::hash<unsigned>, std::equal_to<unsigned>, Power_Of_Two_Growth> M(1024);
+  for(unsigned key = 0; key < 1024; key++) { M.insert(key, key + 0.5); }
+  REQUIRE( M.migrating() == false );
+  M.insert(1024, 1024.5);
+  REQUIRE( M.bucket_count() == 2048 );
+  for(unsigned i = 1; i < 16; i++) {
+    REQUIRE( M.migrating() == true );
+    for(unsigned key = i; key < 1024; key += 16) { REQUIRE( M.search(key) == key + 0.5 ); }
+    M.insert(1024, 1024.5 + i);
+    REQUIRE( M.search(1024) == 1024.5 + i );
+  } // for(unsigned i = 1; i < 16; i++) {
+  REQUIRE( M.migrating() == false );
+  REQUIRE( M.size() == 1025 );
+  for(unsigned key = 0; key < 1024; key++) { REQUIRE( M.search(key) == key + 0.5 ); }
+  REQUIRE( M.search(1024) == 1039.5 );
+} // TEST_CASE("Lock-free read tests", "[Lock_Free_Read_Hash_Table]") {
+
+
+
+// Every key has the same hash (so they all have the same place in a split-ordered list).
+struct Constant_Hash {
+  size_t operator()(unsigned) const { return 7; }
+}; // struct Constant_Hash {
+
+
+TEST_CASE("Split-ordered list tests", "[Split_Ordered_Hash_Table]") {
+  Check_Concurrent< Split_Ordered_Hash_Table<unsigned, double> >();
+
+  /* Growing just doubles the bucket count. Buckets get dummy nodes when
+  updates use them; lookups don't add any. */
+  Split_Ordered_Hash_Table<unsigned, double> H(1);
+  REQUIRE( H.bucket_count() == 1 );
+  for(unsigned key = 0; key < 1000; key++) { H.insert(key*16, key + 0.5); }
+  REQUIRE( H.size() == 1000 );
+  REQUIRE( H.bucket_count() == 1024 );
+  unsigned N_Initialized = H.initialized_bucket_count();
+  REQUIRE( N_Initialized <= 1024 );
+  for(unsigned key = 0; key < 2000; key++) { REQUIRE( H.contains(key*16) == (key < 1000) ); }
+  REQUIRE( H.initialized_bucket_count() == N_Initialized );
+  for(unsigned key = 0; key < 1000; key += 2) { H.remove(key*16); }
+  REQUIRE( H.size() == 500 );
+  REQUIRE( H.search(16) == 1.5 );
+  REQUIRE_THROWS_AS( H.search(0), Invalid_Key );
+
+  // Keys whose hashes are the same are told apart by KeyEqual.
+  Split_Ordered_Hash_Table<unsigned, double, Constant_Hash> Same;
+  for(unsigned key = 0; key < 50; key++) { REQUIRE( Same.emplace(key, key*2.0) == true ); }
+  REQUIRE( Same.emplace(10, 0.0) == false );
+  for(unsigned key = 0; key < 50; key += 3) { Same.remove(key); }
+  for(unsigned key = 0; key < 50; key++) { REQUIRE( Same.get_or(key, -1.0) == ((key % 3 == 0) ? -1.0 : key*2.0) ); }
+  REQUIRE( Same.upsert(1, 5.0, [](double& Value, const double& init) { Value += init; }) == false );
+  REQUIRE( Same.search(1) == 7.0 );
+
+  /* Threads race to add and then remove the same keys: each key should be
+  added, and removed, exactly once. */
+  const unsigned N_Threads = 8, N_Keys = 5000;
+  Split_Ordered_Hash_Table<unsigned, double> Race(1);
+  std::vector<unsigned> N_Added(N_Threads, 0);
+  Run_Threads(N_Threads, [&](unsigned t) {
+    for(unsigned i = 0; i < N_Keys; i++) {
+      if(Race.emplace((i*7 + t) % N_Keys, t) == true) { N_Added[t]++; }
+    } // for(unsigned i = 0; i < N_Keys; i++) {
+  }); // Run_Threads(N_Threads, [&](unsigned t) {
+
+  unsigned Total_Added = 0;
+  for(unsigned t = 0; t < N_Threads; t++) { Total_Added += N_Added[t]; }
+  REQUIRE( Total_Added == N_Keys );
+  REQUIRE( Race.size() == N_Keys );
+
+  Run_Threads(N_Threads, [&](unsigned t) {
+    for(unsigned i = 0; i < N_Keys; i++) { Race.remove((i*3 + t) % N_Keys); }
+  }); // Run_Threads(N_Threads, [&](unsigned t) {
+  REQUIRE( Race.size() == 0 );
+  for(unsigned key = 0; key < N_Keys; key++) { REQUIRE( Race.contains(key) == false ); }
+
+  // With nobody reading, everything that was retired can be freed.
+  for(unsigned i = 0; i < 3; i++) { Race.epochs().collect(); }
+  REQUIRE( Race.epochs().retired_count() == 0 );
+} // TEST_CASE("Split-ordered list tests", "[Split_Ordered_Hash_Table]") {
+
+
+
+/* The length of the longest run of consecutive buckets that a
+Seqlock_Hash_Table says have items overflowed past them (from its printout).
+A lookup that misses can have to look through a whole run. */
+template<typename Table>
+unsigned Longest_Overflow_Run(const Table& H) {
+  std::ostringstream Out;
+  Out << H;
+
+  std::istringstream In(Out.str());
+  std::string Line;
+  unsigned Run = 0, Longest = 0;
+  while(std::getline(In, Line)) {
+    if(Line.find("overflowed") == std::string::npos) { Run = 0; }
+    else { Longest = std::max(Longest, ++Run); }
+  } // while(std::getline(In, Line)) {
+  return Longest;
+} // unsigned Longest_Overflow_Run(const Table& H) {
+
+
+TEST_CASE("Seqlock tests", "[Seqlock_Hash_Table]") {
+  Check_Concurrent< Seqlock_Hash_Table<unsigned, double> >();
+
+  // An unsigned key and a double take two words, so three fit in a bucket.
+  REQUIRE( (Seqlock_Hash_Table<unsigned, double>::Slots_Per_Bucket) == 3 );
+  REQUIRE( (Seqlock_Hash_Table<unsigned, Point>::Slots_Per_Bucket) == 3 );
+
+  /* Items that don't fit in their bucket overflow into the buckets after it,
+  and lookups follow them (even after items in between are removed). When
+  they run off the end of the array, the table grows. */
+  Seqlock_Hash_Table<unsigned, double, Constant_Hash> Same;
+  unsigned N_Buckets = Same.bucket_count();
+  for(unsigned key = 0; key < 200; key++) { REQUIRE( Same.emplace(key, key*2.0) == true ); }
+  REQUIRE( Same.emplace(10, 0.0) == false );
+  REQUIRE( Same.bucket_count() > N_Buckets );
+  for(unsigned key = 0; key < 200; key += 3) { Same.remove(key); }
+  for(unsigned key = 0; key < 200; key++) { REQUIRE( Same.get_or(key, -1.0) == ((key % 3 == 0) ? -1.0 : key*2.0) ); }
+  REQUIRE( Same.upsert(1, 5.0, [](double& Value, const double& init) { Value += init; }) == false );
+  REQUIRE( Same.search(1) == 7.0 );
+  REQUIRE_THROWS_AS( Same.search(0), Invalid_Key );
+
+  /* Churn a table at a fixed size, removing the oldest key and adding a new
+  one each time. Removing an item takes it back out of the overflow counts
+  it was added to, so the runs of overflowed buckets that misses have to
+  look through stay short (rather than growing until they cover the whole
+  table), and once the table is empty nothing is overflowed. */
+  const unsigned N_Live = 800, N_Churn = 100*N_Live;
+  std::vector<unsigned> Keys(N_Churn);
+  srand(1);
+  for(unsigned i = 0; i < N_Churn; i++) { Keys[i] = (unsigned)rand(); }
+
+  Seqlock_Hash_Table<unsigned, double> Churn{383};
+  for(unsigned i = 0; i < N_Live; i++) { Churn.insert(Keys[i], i); }
+  N_Buckets = Churn.bucket_count();
+  for(unsigned i = N_Live; i < N_Churn; i++) {
+    Churn.remove(Keys[i - N_Live]);
+    Churn.insert(Keys[i], i);
+  } // for(unsigned i = N_Live; i < N_Churn; i++) {
+  REQUIRE( Churn.size() == N_Live );
+  REQUIRE( Churn.bucket_count() == N_Buckets );
+  REQUIRE( Longest_Overflow_Run(Churn) < N_Buckets/4 );
+  for(unsigned i = N_Churn - N_Live; i < N_Churn; i++) { REQUIRE( Churn.search(Keys[i]) == i ); }
+
+  for(unsigned i = N_Churn - N_Live; i < N_Churn; i++) { Churn.remove(Keys[i]); }
+  REQUIRE( Churn.size() == 0 );
+  REQUIRE( Longest_Overflow_Run(Churn) == 0 );
+
+  /* Readers look up keys 0-999 (which are always in the table) while writers
+  keep changing their values (always to {n, -n}) and add and remove other
+  keys (growing the table several times). Readers should always find the
+  stable keys, and never see half of an update. */
+  const unsigned N_Stable = 1000, N_Readers = 4, N_Writers = 4;
+  Seqlock_Hash_Table<unsigned, Point> H;
+  for(unsigned key = 0; key < N_Stable; key++) { H.insert(key, Point{0, 0}); }
+
+  std::atomic<unsigned> N_Writers_Done(0);
+  std::vector<char> Reader_Ok(N_Readers, 1);
+  Run_Threads(N_Readers + N_Writers, [&](unsigned t) {
+    if(t < N_Writers) {
+      for(unsigned i = 0; i < 20000; i++) {
+        int n = (int)i + 1;
+        H.insert((i*7 + t) % N_Stable, Point{n, -n});
+        H.modify((i*3 + t) % N_Stable, [](Point& Value) { Value.x++; Value.y--; });
+
+        unsigned Extra = 1000000 + t*20000 + i;
+        H.insert(Extra, Point{1, -1});
+        if(i % 2 == 0) { H.remove(Extra); }
+      } // for(unsigned i = 0; i < 20000; i++) {
+      N_Writers_Done++;
+    } // if(t < N_Writers) {
+    else {
+      unsigned r = t - N_Writers;
+      while(N_Writers_Done.load() < N_Writers) {
+        for(unsigned key = 0; key < N_Stable; key++) {
+          Point Value{1, 1};
+          if(H.find(key, Value) == false || Value.x != -Value.y) { Reader_Ok[r] = 0; }
+        } // for(unsigned key = 0; key < N_Stable; key++) {
+      } // while(N_Writers_Done.load() < N_Writers) {
+    } // else
+  }); // Run_Threads(N_Readers + N_Writers, [&](unsigned t) {
+
+  for(unsigned r = 0; r < N_Readers; r++) { REQUIRE( Reader_Ok[r] == 1 ); }
+  REQUIRE( H.size() == N_Stable + N_Writers*10000 );
+  REQUIRE( H.load_factor() <= H.max_load_factor() );
+  REQUIRE( H.contains(1000000 + 1) == true );
+  REQUIRE( H.contains(1000000) == false );
+} // TEST_CASE("Seqlock tests", "[Seqlock_Hash_Table]") {